@@ -1,11 +1,25 @@
 #ifndef PROJECT_H
 #define PROJECT_H
 
+// Internal header shared by the engine (inspection_engine.c) and the console program
+// (58_Project.c). Programs that embed the engine include inspection_engine.h instead.
+// The console works on a RecordStore through this header, not through the public
+// handle: its save modes, partitioned layout, search cache and sorted views have no
+// public equivalent. Its save mode, layout and integrity settings for CSV_FILE are
+// defined in 58_Project.c, not in the engine; the engine settings reached here are
+// process-wide, and inspection_engine.h lists the ones that handles read.
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "inspection_engine.h"
 
 // ==================== Named Constants ====================
 #define MAX_RECORDS 1000
@@ -31,20 +45,221 @@
 #define DAYS_IN_MONTH_30 30
 #define DAYS_IN_MONTH_31 31
 
-#define MENU_ADD_RECORD 1
-#define MENU_SEARCH_RECORD 2
-#define MENU_UPDATE_RECORD 3
-#define MENU_DELETE_RECORD 4
-#define MENU_DISPLAY_ALL 5
-#define MENU_UNIT_TESTS 6
-#define MENU_E2E_TEST 7
-#define MENU_EXIT 8
-#define MENU_BACK 0
+#define VALID_ID 0x01
+#define VALID_CAR_REG 0x02
+#define VALID_OWNER 0x04
+#define VALID_DATE 0x08
+#define VALID_ALL (VALID_ID | VALID_CAR_REG | VALID_OWNER | VALID_DATE)
+
+#define PARALLEL_SCAN_THRESHOLD 50000
+#define SCAN_MIN_CHUNK_ROWS 4096
+#define SCAN_CHUNKS_PER_WORKER 4
+#define THREAD_POOL_MAX_WORKERS 64
+#define TASK_DEQUE_INITIAL_CAPACITY 64
+#define STORE_INITIAL_CAPACITY 1024
+#define OWNER_POOL_INITIAL_SLOTS 1024
+#define OWNER_POOL_INITIAL_BYTES 16384
+#define OWNER_HANDLE_NONE UINT32_MAX
+#define SORT_BY_DATE 0
+#define SORT_BY_PLATE 1
+#define SORT_BY_OWNER 2
+#define SORT_FIELD_COUNT 3
+#define REPORT_YEARS (MAX_YEAR - MIN_YEAR + 1)
+#define REPORT_MONTHS (REPORT_YEARS * MONTHS_IN_YEAR)
+#define REPORT_PREFIXES (26 * 26 * 26)
+#define REPORT_TOP_N 10
+#define REPORT_MAP_INITIAL_SLOTS 256
+#define TOP_K_DEFAULT 50
+#define OVERDUE_DEFAULT_DAYS 365
+#define OVERDUE_MAX_DAYS 36500
+#define SCAN_MAX_CHUNKS ((THREAD_POOL_MAX_WORKERS + 1) * SCAN_CHUNKS_PER_WORKER)
+#define SCAN_STRESS_ROUNDS 20000 // back-to-back scans in the search unit test
+
+#define CSV_HASH_SEED 14695981039346656037ULL
+#define CSV_HASH_PRIME 1099511628211ULL
+#define CSV_VERIFY_BLOCK (64 * 1024)
+#define CSV_RACY_SECONDS 2
+#define CSV_WATCH_UNSET (-2)
+
+// Streaming key search
+#define CSV_SEARCH_BLOCK (256 * 1024)
+
+// Filter expressions
+#define QUERY_FIELD_ID 0
+#define QUERY_FIELD_PLATE 1
+#define QUERY_FIELD_OWNER 2
+#define QUERY_FIELD_DATE 3
+#define QUERY_EQ 0
+#define QUERY_NE 1
+#define QUERY_PREFIX 2
+#define QUERY_CONTAINS 3
+#define QUERY_LT 4
+#define QUERY_LE 5
+#define QUERY_GT 6
+#define QUERY_GE 7
+#define QUERY_OP_PRED 0
+#define QUERY_OP_AND_PRED 1
+#define QUERY_OP_OR_PRED 2
+#define QUERY_OP_AND 3
+#define QUERY_OP_OR 4
+#define QUERY_OP_NOT 5
+#define QUERY_MAX_PREDICATES 32
+#define QUERY_MAX_PROGRAM (2 * QUERY_MAX_PREDICATES)
+#define QUERY_MAX_DEPTH 16
+
+// Export
+#define EXPORT_CSV 0
+#define EXPORT_NDJSON 1
+#define EXPORT_MAX_COLUMNS 4
+#define EXPORT_BUFFER_BYTES (256 * 1024)
+#define EXPORT_ROW_MAX (EXPORT_MAX_COLUMNS * (6 * OWNER_MAX_LEN + 24))
+
+#define PERSIST_ADD 0
+#define PERSIST_SET 1
+#define PERSIST_REMOVE 2
+#define SAVE_NO_SYNC 0 // store_save_path: write and rename only
+#define SAVE_SYNC_DATA 1 // ...flush the new file before the rename
+#define SAVE_SYNC_ALL 2 // ...and flush the directory after it
+#define WRITE_BEHIND_DEFAULT_FSYNC_MS 1000
+#define WRITE_BEHIND_MAX_FSYNC_MS 60000
+#define WRITE_BEHIND_COALESCE_MS 5
+#define WRITE_BEHIND_MAX_DELAY_MS 100
+#define WRITE_BEHIND_RETRY_MS 1000
+#define WRITE_BEHIND_INITIAL_OPS 64
+
+#define GROUP_COMMIT_DEFAULT_BATCH 64
+#define GROUP_COMMIT_MAX_BATCH 1024
+#define GROUP_COMMIT_DEFAULT_WINDOW_US 0
+#define GROUP_COMMIT_MAX_WINDOW_US 100000
+#define GROUP_COMMIT_INITIAL_BYTES 4096
+
+#define CSV_INDEX_EXT ".idx"
+#define DISK_INDEX_MAGIC "INSPIDX2"
+#define DISK_INDEX_PAGE 4096
+#define DISK_LEAF_MAX 255
+#define DISK_INTERNAL_MAX 203
+#define DISK_INDEX_MAX_HEIGHT 16
+#define DISK_BUILD_FILL 90
+#define DISK_INDEX_TAIL_CHECK 64
+#define DISK_KEY_HASHED (1ULL << 63)
+#define DISK_PAGE_LEAF 1
+#define DISK_PAGE_INTERNAL 2
+
+// Key filter (blocked Bloom filter)
+#define KEY_FILTER_DEFAULT_BITS 10
+#define KEY_FILTER_MAX_BITS 32
+#define KEY_FILTER_MAX_HASHES 16
+#define KEY_FILTER_BLOCK_BITS 512
+#define KEY_FILTER_BLOCK_WORDS (KEY_FILTER_BLOCK_BITS / 64)
+#define KEY_FILTER_MIN_KEYS 1024
+#define KEY_FILTER_HEADROOM 4
+#define KEY_FILTER_FP_PER_BIT 0.6185
+#define KEY_FILTER_MIN_FP_PERCENT 0.0001
+#define KEY_FILTER_MAX_FP_PERCENT 50.0
+
+// Partitioned layout (one CSV per month)
+#define PARTITION_DIR "users_data.parts"
+#define PARTITION_MANIFEST "manifest.csv"
+#define PARTITION_ARCHIVE_DIR "archive"
+#define PARTITION_UNDATED "undated"
+#define PARTITION_UNDATED_SLOT REPORT_MONTHS
+#define PARTITION_SLOTS (REPORT_MONTHS + 1)
+#define PARTITION_NAME_LEN 16
+#define PARTITION_DIR_LEN 256
+#define PARTITION_INITIAL_CAP 64
+#define PARTITION_ARCHIVE_DEFAULT_MONTHS 24
+
+// Columnar archive (compressed cold history)
+#define COLUMN_ARCHIVE_EXT ".icol"
+#define COLUMN_ARCHIVE_MAGIC "INSPCOL1"
+#define COLUMN_COUNT 4
+#define COLUMN_ALL 0xFu
+#define COLUMN_BLOCK_ROWS 4096
+#define COLUMN_DIGITS 9
+#define COLUMN_SEGMENT_MAX (COLUMN_BLOCK_ROWS * (OWNER_BUFFER_LEN + 12) + 64)
+#define COLUMN_DATE_DELTA 0
+#define COLUMN_DATE_DICT 1
+
+// Integrity sweep (one bit per problem, in the order the report lists them)
+#define INTEGRITY_SHORT_ROW 0x01u // fewer than 4 fields: a load skips the row
+#define INTEGRITY_EXTRA_FIELDS 0x02u // more than 4: a load drops the rest
+#define INTEGRITY_LONG_LINE 0x04u // longer than a load reads at once: it becomes several rows
+#define INTEGRITY_BAD_ID 0x08u
+#define INTEGRITY_BAD_CAR_REG 0x10u
+#define INTEGRITY_BAD_OWNER 0x20u
+#define INTEGRITY_BAD_DATE 0x40u
+#define INTEGRITY_DUPLICATE_ID 0x80u // an earlier row has the same InspectionID
+#define INTEGRITY_KINDS 8
+#define INTEGRITY_ID_SLOTS (26 * 999) // valid InspectionIDs: A001..Z999
+#define INTEGRITY_BLOCK_BYTES (4 * 1024 * 1024)
+#define INTEGRITY_QUARANTINE_EXT ".quarantine.csv"
+
+// Snapshot store (MVCC, epoch-based reclamation)
+#define MVCC_CHUNK_ROWS 64 // rows copied by a writer that changes one of them
+#define MVCC_PAGE_CHUNKS 512 // chunk pointers per page of a version's directory
+#define MVCC_MAX_READERS 64 // reader slots, one per thread that pins snapshots
+
+// Load generator (mixed workload with a reference model)
+#define LOADGEN_LOOKUP 0
+#define LOADGEN_ADD 1
+#define LOADGEN_UPDATE 2
+#define LOADGEN_DELETE 3
+#define LOADGEN_RANGE 4
+#define LOADGEN_OPS 5
+#define LOADGEN_MAX_WORKERS 64
+#define LOADGEN_DEFAULT_MIX "60,10,15,5,10" // lookup,add,update,delete,range weights
+#define LOADGEN_DEFAULT_OPS 20000 // per worker
+#define LOADGEN_DEFAULT_ROWS 12000 // of the INTEGRITY_ID_SLOTS possible keys
+#define LOADGEN_DEFAULT_SEED 1
+#define LOADGEN_RANGE_DAYS 31 // window of a range query
+#define LOADGEN_LAT_SUB_BITS 4 // 16 latency buckets per power of two: percentiles within 1/16
+#define LOADGEN_LAT_BUCKETS ((40 - LOADGEN_LAT_SUB_BITS + 1) << LOADGEN_LAT_SUB_BITS) // up to ~2^40 us
+#define LOADGEN_FILE "users_data.loadgen.csv" // shared by process workers, removed afterwards
+
+#define API_TEST_THREADS 4
+#define API_TEST_ROWS 25 // adds per thread in the embedding API unit test
+#define API_TEST_WAIT_MS 5000 // how long a scan waits for a concurrent add before failing
+
+#define ARENA_BLOCK_SIZE (256 * 1024)
+#define ARENA_ALIGN 16
+#define DISPLAY_CHUNK_BYTES (64 * 1024)
+#define TABLE_ROW_BYTES (ID_REG_MAX_LEN + CAR_REG_MAX_LEN + OWNER_MAX_LEN + DATE_MAX_LEN + 11)
+
+// Search result cache
+#define SEARCH_CACHE_DEFAULT_ENTRIES 64
+#define SEARCH_CACHE_MAX_ENTRIES 4096
+#define SEARCH_CACHE_MAX_ENTRY_BYTES (64 * 1024)
+
+#define KEY_SLOT_LEN 8
+#define KEY_SLOT_OVERFLOW 0xFF
+#define KEY_BLOCK_ROWS 32
+
+#define BENCH_DEFAULT_ROWS 1000000
+#define BENCH_REPEATS 5
+#define BENCH_SCRATCH_OPS 200000
+#define BENCH_FLEET_PERCENT 30
+#define BENCH_SORT_ROWS 10000000
+#define BENCH_GEN_CHUNK 65536
+#define BENCH_REPORT_ROWS 2000000
+#define BENCH_HISTORY_DEPTH 4
+#define BENCH_TAIL_ROWS 1000
+#define BENCH_WRITE_BEHIND_ROWS 100000
+#define BENCH_GROUP_COMMITS 2000
+#define BENCH_COMMIT_THREADS 16
+#define BENCH_INDEX_LOOKUPS 1000
+#define BENCH_FILTER_PROBES 200000
+#define BENCH_RANGE_QUERIES 20
+#define BENCH_MVCC_READERS 2
+#define BENCH_MVCC_SCANS 20 // full scans per reader in the snapshot benchmark
+#define BENCH_MVCC_WRITES 100000 // updates when the writer runs alone
+#define BENCH_INTEGRITY_FAULT_EVERY 1000 // one damaged row per this many in the integrity benchmark
 
 #if defined(_WIN32) || defined(_WIN64)
     #define strcasecmp _stricmp
+    #define strncasecmp _strnicmp
 #else
     #include <strings.h>
+    #define _stricmp strcasecmp
 #endif
 
 // ==================== Structs ====================
@@ -55,10 +270,517 @@ typedef struct {
     char date[DATE_BUFFER_LEN];
 } Record;
 
+typedef struct {
+    unsigned char b[KEY_SLOT_LEN];
+} KeySlot;
+
+typedef struct {
+    KeySlot folded;
+    const char *key;
+    int verify;
+} KeyQuery;
+
+typedef uint32_t OwnerHandle;
+
+typedef struct {
+    char *bytes;
+    size_t bytes_used;
+    size_t bytes_cap;
+    uint32_t *offsets;
+    uint32_t count;
+    uint32_t offsets_cap;
+    uint32_t *slots;
+    uint32_t slot_cap;
+} OwnerPool;
+
+typedef struct {
+    char inspectionID[ID_REG_BUFFER_LEN];
+    char carReg[CAR_REG_BUFFER_LEN];
+    char date[DATE_BUFFER_LEN];
+    OwnerHandle owner;
+} StoredRow;
+
+typedef struct {
+    int *perm;
+    int *rank;
+    unsigned long version;
+    unsigned long rank_version;
+} SortView;
+
+typedef struct {
+    uint32_t key;
+    uint32_t count;
+} CountSlot;
+
+typedef struct {
+    CountSlot *slots;
+    uint32_t cap;
+    uint32_t used;
+} CountMap;
+
+typedef struct {
+    uint32_t months[REPORT_MONTHS];
+    uint32_t prefixes[REPORT_PREFIXES];
+    CountMap owners;
+    uint32_t undated;
+    uint32_t unprefixed;
+    uint32_t rows;
+    int oom;
+} Report;
+
+typedef struct {
+    uint64_t key;
+    int begin;
+    int count;
+} PlateGroup;
+
+typedef struct {
+    int *rows;
+    PlateGroup *groups;
+    int ngroups;
+    unsigned long version;
+} PlateIndex;
+
+typedef struct {
+    unsigned long long size;
+    unsigned long long ino;
+    long long mtime_ns;
+} FileStamp;
+
+typedef struct {
+    unsigned long long offset;
+    uint64_t hash;
+    int newline_end;
+    FileStamp stamp;
+    time_t stamped_at;
+    unsigned long version;
+    int watch_fd;
+    int detached;
+    long full_loads;
+    long tail_loads;
+    long skipped_loads;
+    int error; // errno of the last load that fell short (ENOMEM when rows did not fit), else 0
+} CsvSync;
+
+typedef struct {
+    long long bytes_read;
+    long lines;
+    double first_hit_ms;
+    int stopped_early;
+} StreamSearchStats;
+
+typedef struct {
+    int field;
+    int op;
+    char text[OWNER_BUFFER_LEN];
+    char folded[OWNER_BUFFER_LEN];
+    size_t len;
+    uint32_t day;
+    double estimate;
+    long examined;
+    long matched;
+    double ms;
+} QueryPred;
+
+typedef struct {
+    int op;
+    int pred;
+} QueryInstr;
+
+typedef struct {
+    QueryPred preds[QUERY_MAX_PREDICATES];
+    int npreds;
+    QueryInstr code[QUERY_MAX_PROGRAM];
+    int ncode;
+    int depth;
+    double estimate;
+    int ran;
+    double run_ms;
+    char error[INPUT_BUFFER_SIZE];
+} Query;
+
+typedef struct {
+    FILE *out;
+    char *buf;
+    size_t len;
+    size_t cap;
+    int format;
+    int columns[EXPORT_MAX_COLUMNS];
+    int ncolumns;
+    long rows;
+    unsigned long long bytes;
+    int failed;
+} ExportWriter;
+
+typedef struct {
+    uint64_t *blocks;
+    uint32_t nblocks;
+    int hashes;
+    uint64_t capacity;
+    uint64_t keys;
+    int valid;
+} KeyFilter;
+
+typedef struct {
+    int enabled;
+    int bits_per_key;
+    atomic_long probes;
+    atomic_long negatives;
+    atomic_long false_positives;
+    atomic_long rebuilds;
+} KeyFilterConfig;
+
+typedef struct {
+    char key[ID_REG_BUFFER_LEN];
+    int sort_field;
+    int rows;
+    char *text;
+    size_t len;
+    int prev, next;
+    int hnext;
+} SearchCacheEntry;
+
+typedef struct {
+    SearchCacheEntry *entries;
+    int *buckets;
+    int capacity;
+    int nbuckets;
+    int count;
+    int head, tail;
+    int free_list;
+    size_t bytes;
+    long hits;
+    long misses;
+    long invalidations;
+    long evictions;
+    long flushes;
+} SearchCache;
+
+typedef struct {
+    StoredRow *rows;
+    KeySlot *id_keys;
+    KeySlot *reg_keys;
+    uint32_t *day_keys;
+    OwnerPool owners;
+    int count;
+    int capacity;
+    unsigned long version;
+    SortView views[SORT_FIELD_COUNT];
+    uint64_t *sort_scratch;
+    size_t sort_scratch_cap;
+    PlateIndex plate_index;
+    CsvSync csv;
+    KeyFilter filter;
+    SearchCache cache;
+} RecordStore;
+
+typedef struct {
+    int kind;
+    int row;
+    Record rec;
+} PersistOp;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+    pthread_t thread;
+    int running;
+    int stop;
+    PersistOp *ops;
+    int nops;
+    int cap;
+    int busy;
+    RecordStore shadow;
+    const char *path;
+    int fsync_ms;
+    int dirty;
+    double dirty_since;
+    double last_push_ms;
+    double last_durable_ms;
+    long writes;
+    long ops_written;
+    long fsyncs;
+    long failures;
+} WriteBehind;
+
+typedef struct {
+    int running;
+    int fsync_ms;
+    int depth;
+    int dirty;
+    double since_durable_ms;
+    long writes;
+    long ops_written;
+    long fsyncs;
+    long failures;
+} WriteBehindStats;
+
+typedef struct {
+    size_t pos;
+    int done;
+    int ok;
+    unsigned long long at;
+} CommitTicket;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t more;
+    pthread_cond_t done;
+    int enabled;
+    const char *path;
+    int max_batch;
+    int window_us;
+    char *buf;
+    size_t len;
+    size_t cap;
+    CommitTicket **tickets;
+    int pending;
+    int flushing;
+    long commits;
+    long batches;
+    long failures;
+    double sync_ms;
+} GroupCommit;
+
+typedef struct {
+    uint64_t key;
+    uint64_t off;
+} IndexEntry;
+
+typedef struct {
+    uint32_t type;
+    uint32_t count;
+    uint32_t next;
+    uint32_t reserved;
+    union {
+        IndexEntry entries[DISK_LEAF_MAX];
+        struct {
+            IndexEntry keys[DISK_INTERNAL_MAX];
+            uint32_t child[DISK_INTERNAL_MAX + 1];
+        } node;
+    } u;
+} DiskPage;
+
+typedef struct {
+    char magic[8];
+    uint32_t page_size;
+    uint32_t root;
+    uint32_t height;
+    uint32_t npages;
+    uint32_t clean;
+    uint32_t reserved;
+    uint64_t entries;
+    uint64_t data_bytes;
+    uint64_t tail_hash;
+    uint32_t filter_blocks;
+    uint32_t filter_hashes;
+    uint64_t filter_capacity;
+    uint64_t filter_keys;
+} IndexMeta;
+
+typedef struct {
+    FILE *f;
+    IndexMeta meta;
+    long pages_read;
+} DiskIndex;
+
+typedef struct {
+    int slot;
+    int rows;
+    uint32_t min_day, max_day;
+    char min_date[DATE_BUFFER_LEN];
+    char max_date[DATE_BUFFER_LEN];
+    int archived;
+} PartitionInfo;
+
+typedef struct {
+    char dir[PARTITION_DIR_LEN];
+    PartitionInfo *parts;
+    int count;
+    int cap;
+    unsigned long generation;
+    uint64_t manifest_hash;
+    long files_read;
+    long files_pruned;
+    long rewrites;
+    long appends;
+    char error[MAX_LINE + INPUT_BUFFER_SIZE]; // what the last load, range or top-k call could not read
+} PartitionLayout;
+
+typedef struct {
+    char magic[8];
+    uint32_t block_rows;
+    uint32_t blocks;
+    uint64_t rows;
+    uint64_t source_bytes;
+    uint64_t column_bytes[COLUMN_COUNT];
+} ColumnArchiveMeta;
+
+typedef struct {
+    long blocks_read;
+    long blocks_skipped;
+    long segments_read;
+    unsigned long long bytes_read;
+} ColumnScanStats;
+
+typedef struct {
+    Record rows[MVCC_CHUNK_ROWS];
+    KeySlot id_keys[MVCC_CHUNK_ROWS]; // rows' keys folded for key_column_find
+    KeySlot reg_keys[MVCC_CHUNK_ROWS];
+} MvccChunk;
+
+typedef struct {
+    MvccChunk *chunks[MVCC_PAGE_CHUNKS];
+} MvccPage;
+
+typedef struct {
+    MvccPage **pages;
+    int npages;
+    int count;
+    uint64_t serial; // 1 for the first version, +1 per publish
+    KeyFilter *filter; // every key on the rows (and some that were), shared until rebuilt; NULL when off
+} MvccVersion;
+
+typedef struct MvccRetired {
+    struct MvccRetired *next;
+    uint64_t epoch;
+    void *ptr;
+    size_t bytes;
+} MvccRetired;
+
+typedef struct {
+    void *ptr;
+    size_t bytes;
+} MvccBlock;
+
+typedef struct {
+    _Atomic(MvccVersion *) current;
+    atomic_ullong epoch;
+    atomic_ullong pinned[MVCC_MAX_READERS]; // epoch a reader pinned at, 0 when idle
+    atomic_int claimed[MVCC_MAX_READERS];
+    pthread_mutex_t write_lock;
+    MvccBlock *dead;
+    int ndead, dead_cap;
+    void **fresh;
+    int nfresh, fresh_cap;
+    MvccRetired *retired; // oldest first
+    MvccRetired *retired_tail;
+    long retired_pending;
+    unsigned long long retired_bytes;
+    unsigned long long freed_bytes;
+    long versions;
+    long chunks_copied;
+} MvccStore;
+
+typedef struct {
+    long lines; // lines read, blank ones included
+    long rows; // non-blank lines, each a row to a load
+    long quarantined; // rows with at least one problem
+    long problems[INTEGRITY_KINDS]; // rows with each problem, in bit order
+    int threads;
+    double ms;
+} IntegrityReport;
+
+typedef struct {
+    int on_load; // sweep CSV_FILE whenever store_load reads it in full
+    int have_last;
+    IntegrityReport last;
+} IntegrityConfig;
+
+typedef struct {
+    int mix[LOADGEN_OPS]; // weights, LOADGEN_LOOKUP ..
+    int workers;
+    int processes; // 1: the workers are processes sharing path
+    double rate; // target ops/s over all workers; 0 runs flat out
+    long ops; // per worker
+    int rows; // present before the run
+    unsigned long long seed;
+    char path[MAX_LINE]; // the shared file in process mode
+} LoadgenConfig;
+
+typedef struct {
+    long count[LOADGEN_OPS];
+    long errors[LOADGEN_OPS]; // answers that disagree with the reference model
+    long latency[LOADGEN_OPS][LOADGEN_LAT_BUCKETS]; // microseconds, log-linear buckets
+    double max_us[LOADGEN_OPS];
+    long skipped; // adds with every key taken, updates or deletes with none left
+    double ms; // wall time of the run
+    int final_rows; // in the store (or file) after the run
+    long final_diffs; // rows missing, extra or different from the replayed model
+    char first_error[MAX_LINE];
+} LoadgenStats;
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    size_t used;
+    size_t peak;
+    size_t reserved;
+    long allocs;
+    size_t last_used;
+    long last_allocs;
+    long resets;
+    long block_mallocs;
+} Arena;
+
+typedef struct ThreadPool ThreadPool;
+typedef struct TaskGroup TaskGroup;
+typedef void (*TaskFn)(void *arg);
+typedef void (*ScanChunkFn)(int begin, int end, void *ctx, void *out);
+typedef int (*RowPredicate)(int row, void *ctx);
+typedef void (*RecordFn)(const Record *r, void *ctx);
+
+typedef struct {
+    int *idx;
+    int count;
+    int capacity;
+} IndexList;
+
+typedef struct {
+    const Record *rows;
+    const char *key;
+} KeyMatchCtx;
+
+typedef struct {
+    uint64_t key;
+    int slot;
+} HeapItem;
+
 // ==================== Utility Functions ====================
-void clear_screen(void);
 void trim_whitespace(char *str);
-int input_line(char *prompt, char *buf, int bufsize);
+int cpu_count(void);
+double now_ms(void);
+int file_sync(const char *path);
+int file_append_sync(const char *path, const char *buf, size_t len, unsigned long long *start);
+int file_replace(const char *tmp, const char *path);
+int dir_sync(const char *path);
+void sleep_ms(double ms);
+int make_dir(const char *path);
+int dir_remove(const char *path);
+int file_seek(FILE *f, unsigned long long off);
+
+// ==================== Scratch Arena ====================
+void arena_init(Arena *arena);
+void arena_free(Arena *arena);
+void *arena_alloc(Arena *arena, size_t size);
+void arena_reset(Arena *arena);
+
+// ==================== Thread Pool / Parallel Scan ====================
+ThreadPool *thread_pool_create(int nworkers);
+void thread_pool_destroy(ThreadPool *pool);
+int scan_thread_count(const ThreadPool *pool);
+void task_group_init(TaskGroup *g);
+void task_group_destroy(TaskGroup *g);
+void thread_pool_submit(ThreadPool *pool, TaskGroup *g, TaskFn fn, void *arg);
+void task_group_wait(ThreadPool *pool, TaskGroup *g);
+ThreadPool *scan_pool(void);
+int scan_chunk_rows(const ThreadPool *pool, int n);
+int scan_chunk_count(const ThreadPool *pool, int n);
+int parallel_scan(ThreadPool *pool, int n, ScanChunkFn fn, void *ctx, void *outs, size_t out_size);
+int parallel_find_first(ThreadPool *pool, int n, RowPredicate pred, void *ctx);
+int parallel_collect(ThreadPool *pool, int n, RowPredicate pred, void *ctx, Arena *arena, int **out_idx);
 
 // ==================== Validation ====================
 int is_alnum_char(char c);
@@ -67,24 +789,284 @@ int is_valid_car_reg(const char *reg);
 int is_valid_owner_name(const char *s);
 int is_leap_year(int y);
 int is_valid_date(const char *s, char *normalized);
-int confirmAction(const char *message);
 
-// ==================== Assertion ====================
-void assert_equal_int(int actual, int expected, const char *msg);
-void assert_equal_string(const char *actual, const char *expected, const char *msg);
+// ==================== Fast Validation (bulk ingestion) ====================
+int days_in_month(int m, int y);
+int is_valid_id_fast(const char *id);
+int is_valid_car_reg_fast(const char *reg);
+int is_valid_owner_name_fast(const char *s);
+int is_valid_date_fast(const char *s, char *normalized);
+uint32_t date_day_number(const char *s);
+int day_month_index(uint32_t day);
+void day_number_date(uint32_t day, char *out);
+int validate_records_batch(const Record *rows, int n, unsigned char *flags, char (*normalized_dates)[DATE_BUFFER_LEN]);
 
 // ==================== Search / Find ====================
+int row_matches_key(int row, void *ctx);
 int find_case_insensitive(Record *arr, int n, const char *key);
 int find_by_id_or_reg(Record arr[], int n, const char *key);
 
+// ==================== Key Column Kernel ====================
+void key_slot_set(KeySlot *k, const char *s);
+void key_query_init(KeyQuery *q, const char *key);
+const char *key_kernel_name(void);
+int key_kernel_use(const char *name);
+int key_slot_matches(const KeySlot *k, const KeyQuery *q);
+int key_column_find(const KeySlot *ids, const KeySlot *regs, int begin, int end, const KeyQuery *q);
+
 // ==================== CSV File Operations ====================
+int parse_record_line(char *line, Record *r);
+int strip_line_ending(char *line);
+
+// ==================== Owner Name Pool ====================
+void owner_pool_init(OwnerPool *pool);
+void owner_pool_free(OwnerPool *pool);
+void owner_pool_clear(OwnerPool *pool);
+OwnerHandle owner_intern(OwnerPool *pool, const char *s);
+OwnerHandle owner_lookup(const OwnerPool *pool, const char *s);
+const char *owner_str(const OwnerPool *pool, OwnerHandle h);
+size_t owner_pool_bytes(const OwnerPool *pool);
+
+// ==================== Record Store ====================
+void store_init(RecordStore *store);
+void store_free(RecordStore *store);
+int store_reserve(RecordStore *store, int capacity);
+int store_append(RecordStore *store, const Record *r);
+int store_set(RecordStore *store, int idx, const Record *r);
+void store_get(const RecordStore *store, int idx, Record *out);
+const char *store_owner(const RecordStore *store, int idx);
+int store_count_owner(const RecordStore *store, const char *name);
+void store_remove(RecordStore *store, int idx);
+int store_find_key(const RecordStore *store, const char *key);
+int store_collect_key(const RecordStore *store, const char *key, Arena *arena, int **out_idx);
+int store_build_filter(RecordStore *store);
+
+// ==================== CSV Sync (incremental reload) ====================
+int file_stamp(const char *path, FileStamp *out);
+int store_load_path(RecordStore *store, const char *path);
+int store_save_path(RecordStore *store, const char *path, int sync);
+void store_note_append(RecordStore *store, const char *path, const char *line, size_t len, unsigned long long at);
+
+// ==================== Write-Behind Persistence ====================
+int write_behind_start(WriteBehind *wb, const RecordStore *store, const char *path, int fsync_ms);
+int write_behind_stop(WriteBehind *wb);
+int write_behind_push(WriteBehind *wb, int kind, int row, const Record *r);
+void write_behind_flush(WriteBehind *wb);
+void write_behind_stats(WriteBehind *wb, WriteBehindStats *out);
+void save_mode_view(RecordStore *store);
+
+// ==================== Group Commit (durable appends) ====================
+int group_commit_init(GroupCommit *gc, const char *path, int max_batch, int window_us);
+void group_commit_free(GroupCommit *gc);
+int group_commit_append(GroupCommit *gc, const char *line, size_t len, unsigned long long *at);
+
+// ==================== Key Filter (negative lookups) ====================
+KeyFilterConfig *key_filter_config(void);
+uint64_t disk_key(const char *s);
+uint64_t key_filter_hash(uint64_t key);
+void key_filter_shape(uint64_t capacity, int bits_per_key, uint32_t *nblocks, int *hashes);
+double key_filter_target_fp(int bits_per_key);
+int key_filter_bits_for(double fp);
+void key_filter_init(KeyFilter *f);
+void key_filter_free(KeyFilter *f);
+int key_filter_reset(KeyFilter *f, uint64_t capacity, int bits_per_key);
+void key_filter_insert(KeyFilter *f, uint64_t dkey);
+void key_filter_add(KeyFilter *f, const char *key);
+int key_filter_may_contain(const KeyFilter *f, const char *key);
+size_t key_filter_bytes(const KeyFilter *f);
+double key_filter_estimated_fp(const KeyFilter *f);
+void key_filter_view(RecordStore *store);
+
+// ==================== Search Result Cache ====================
+int search_cache_entries(void);
+void search_cache_set_entries(int entries);
+void search_cache_init(SearchCache *c);
+void search_cache_reset(SearchCache *c);
+void search_cache_free(SearchCache *c);
+const SearchCacheEntry *search_cache_get(SearchCache *c, const char *key, int sort_field);
+int search_cache_put(SearchCache *c, const char *key, int sort_field, int rows, const char *text, size_t len);
+void search_cache_invalidate(SearchCache *c, const char *key);
+void search_cache_flush(SearchCache *c);
+size_t search_cache_bytes(const SearchCache *c);
+void search_cache_view(RecordStore *store);
+
+// ==================== Integrity Sweep ====================
+void integrity_quarantine_path(const char *csv_path, char *out, size_t cap);
+long integrity_sweep(const char *csv_path, const char *quarantine_path, ThreadPool *pool, IntegrityReport *out);
+void print_integrity_report(const IntegrityReport *r, const char *csv_path, const char *quarantine_path, FILE *out);
+void integrity_view(void);
+
+// ==================== Streaming Key Search ====================
+int record_has_key(const Record *r, const char *key);
+long csv_stream_search(FILE *f, const char *key, int unique_stop, RecordFn emit, void *ctx, StreamSearchStats *st);
+
+// ==================== Filter Expressions ====================
+int query_field_lookup(const char *name);
+int query_compile(Query *q, const char *text);
+int query_is_filter(const char *s);
+int query_collect(Query *q, const RecordStore *store, Arena *arena, int **out_rows);
+int query_string_matches(const QueryPred *p, const char *s);
+int query_record_matches(const Query *q, const Record *r);
+void query_pred_text(const QueryPred *p, char *out, size_t cap);
+void query_explain(const Query *q, int rows, FILE *out);
+
+// ==================== Export (NDJSON / CSV) ====================
+int export_parse_columns(const char *list, int *columns);
+void export_begin(ExportWriter *w, FILE *out, int format, const int *columns, int ncolumns, char *buf, size_t cap);
+void export_row(ExportWriter *w, const char *id, const char *reg, const char *owner, const char *date);
+long export_end(ExportWriter *w);
+long export_store(const RecordStore *store, const int *rows, int n, FILE *out, int format, const int *columns,
+                  int ncolumns);
+
+// ==================== On-Disk Index (one-shot lookups) ====================
+void disk_index_path(const char *csv_path, char *out, size_t cap);
+long disk_index_build(const char *csv_path);
+int disk_index_open(DiskIndex *ix, const char *csv_path, int writable);
+int disk_index_close(DiskIndex *ix);
+int disk_index_refresh(const char *csv_path, int rewritten);
+int disk_index_lookup(const char *csv_path, const char *key, Record **out, long *pages_read);
+int csv_lookup_scan(const char *csv_path, const char *key, Record **out);
+
+// ==================== Partitioned Layout (one CSV per month) ====================
+void partition_layout_init(PartitionLayout *pl, const char *dir);
+int partition_slot(uint32_t day);
+void partition_name(int slot, char *out, size_t cap);
+void partition_path(const PartitionLayout *pl, const PartitionInfo *p, char *out, size_t cap);
+void partition_layout_free(PartitionLayout *pl);
+int partition_layout_active(const PartitionLayout *pl);
+int partition_manifest_read(PartitionLayout *pl);
+int partition_manifest_write(PartitionLayout *pl);
+int partition_split(PartitionLayout *pl, RecordStore *store, const char *flat_path);
+int partition_load(PartitionLayout *pl, RecordStore *store);
+int partition_commit(PartitionLayout *pl, RecordStore *store, int kind, const Record *r);
+int partition_archive(PartitionLayout *pl, int before);
+long partition_merge(PartitionLayout *pl, const char *flat_path);
+long csv_range_scan(FILE *fp, uint32_t from, uint32_t to, RecordFn emit, void *ctx);
+long partition_range(PartitionLayout *pl, uint32_t from, uint32_t to, RecordFn emit, void *ctx);
+void data_layout_view(RecordStore *store);
+
+// ==================== Columnar Archive (cold history) ====================
+void column_archive_path(const char *csv_path, char *out, size_t cap);
+long column_archive_pack(const char *csv_path, const char *out_path);
+int column_archive_read_meta(const char *path, ColumnArchiveMeta *out);
+void print_column_stats(const char *path, const ColumnArchiveMeta *m, FILE *out);
+long column_archive_scan(const char *path, unsigned columns, uint32_t from, uint32_t to, const char *key,
+                         RecordFn emit, void *ctx, ColumnScanStats *st);
+
+// ==================== Snapshot Store (MVCC) ====================
+void mvcc_init(MvccStore *s);
+int mvcc_register(MvccStore *s);
+void mvcc_unregister(MvccStore *s, int slot);
+const MvccVersion *mvcc_pin(MvccStore *s, int slot);
+void mvcc_unpin(MvccStore *s, int slot);
+int mvcc_count(const MvccVersion *v);
+uint64_t mvcc_serial(const MvccVersion *v);
+const Record *mvcc_row(const MvccVersion *v, int i);
+const Record *mvcc_rows_at(const MvccVersion *v, int i, int *n);
+long mvcc_reclaim(MvccStore *s);
+int mvcc_load(MvccStore *s, const Record *rows, int n);
+int mvcc_append(MvccStore *s, const Record *r);
+int mvcc_update(MvccStore *s, int i, const Record *r);
+int mvcc_remove(MvccStore *s, int i);
+int mvcc_collect_key(const MvccVersion *v, const char *key, Arena *arena, int **out_idx);
+void mvcc_free(MvccStore *s);
+
+// ==================== Load Generator ====================
+int loadgen_parse_mix(const char *text, int mix[LOADGEN_OPS]);
+void loadgen_config_init(LoadgenConfig *c);
+int loadgen_run(const LoadgenConfig *c, LoadgenStats *total);
+double loadgen_percentile(const LoadgenStats *s, int op, double p);
+long loadgen_error_count(const LoadgenStats *s);
+void print_loadgen_report(const LoadgenConfig *c, const LoadgenStats *s, FILE *out);
+
+// ==================== Sorted Views ====================
+void radix_sort_u64(uint64_t *vals, uint64_t *tmp, int n, int first_byte);
+const int *store_sorted_view(RecordStore *store, int field);
+const int *store_sorted_rank(RecordStore *store, int field);
+
+// ==================== Reports ====================
+void report_init(Report *r);
+void report_free(Report *r);
+int report_merge(Report *dst, const Report *src);
+int report_build(const RecordStore *store, ThreadPool *pool, Report *out);
+int report_stream_csv(FILE *fp, Report *out, OwnerPool *names);
+int report_top_prefixes(const Report *r, CountSlot *top, int k);
+int report_top_owners(const Report *r, CountSlot *top, int k);
+void reports_view(const RecordStore *store);
+
+// ==================== Top-K by Date ====================
+int store_top_k_by_date(const RecordStore *store, int k, int newest, Arena *arena, int **out_rows);
+int top_k_stream_csv(FILE *fp, int k, int newest, Record *out);
+int partition_top_k(PartitionLayout *pl, int k, int newest, Record *out);
+void top_k_view(RecordStore *store);
+
+// ==================== Vehicle History ====================
+const PlateIndex *store_plate_index(RecordStore *store);
+int store_plate_history(RecordStore *store, const char *plate, const int **rows);
+int store_plate_latest(RecordStore *store, const char *plate);
+int store_overdue(RecordStore *store, uint32_t cutoff_day, Arena *arena, int **out_rows);
+uint32_t date_days_ago(int days, char *out);
+void vehicle_history_view(RecordStore *store);
+void overdue_view(RecordStore *store);
+
+// ==================== Batch (headless) Mode ====================
+int batch_main(int argc, char **argv);
+
+// ==================== Console (58_Project.c) ====================
+void clear_screen(void);
+int input_line(char *prompt, char *buf, int bufsize);
+int confirmAction(const char *message);
+void assert_equal_int(int actual, int expected, const char *msg);
+void assert_equal_string(const char *actual, const char *expected, const char *msg);
+Arena *op_arena(void);
 void fake_save_all(Record recs[], int n);
 int load_all(Record recs[], int max);
 int save_all(Record recs[], int n);
 void ensure_csv_has_sample(void);
+int store_load(RecordStore *store);
+
+// ==================== Console Settings (CSV_FILE) ====================
+IntegrityConfig *integrity_config(void);
+PartitionLayout *partition_layout(void);
+WriteBehind *write_behind(void);
+GroupCommit *group_commit(void);
+int store_save(RecordStore *store);
+int store_commit(RecordStore *store, int kind, int row, const Record *r);
 
 // ==================== Display ====================
 void display_records(Record arr[], int n, const char *title);
-void display_all(void);
+void display_store(const RecordStore *store, const char *title);
+void display_store_sorted(RecordStore *store, int field, int descending, const char *title);
+void display_sorted(RecordStore *store);
+
+// ==================== Statistics ====================
+void stats_view(const RecordStore *store);
+
+// ==================== Benchmarks ====================
+void generate_records(Record *out, int n, unsigned int seed);
+void bench_parallel_scan(int rows);
+void bench_key_compare(int rows);
+void bench_validators(int rows);
+void bench_scratch_alloc(int ops);
+void bench_owner_pool(int rows);
+void bench_sort(int rows);
+void bench_reports(int rows);
+void bench_top_k(int rows);
+void bench_plate_history(int rows);
+void bench_csv_reload(int rows);
+void bench_write_behind(int rows);
+void bench_group_commit(int commits);
+void bench_disk_index(int rows);
+void bench_key_filter(int rows);
+void bench_partitions(int rows);
+void bench_stream_search(int rows);
+void bench_filter_query(int rows);
+void bench_search_cache(int rows);
+void bench_export(int rows);
+void bench_column_archive(int rows);
+void bench_mvcc(int rows);
+void bench_integrity(int rows);
+void bench_loadgen(int rows);
+void benchmark_menu(void);
 
 #endif // _58_PROJECT_H
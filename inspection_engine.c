@@ -0,0 +1,7474 @@
+// inspection_engine.c - storage, validation and search engine behind inspection_engine.h.
+// No console I/O: every result goes back through return values, out parameters or a
+// caller-supplied FILE *. The console program (58_Project.c) links this file.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+    #include <sys/inotify.h>
+#endif
+
+#include "Project.h"
+#include "inspection_engine.h"
+
+// filter expression parse tree (internal to the compiler)
+#define QUERY_NODE_PRED 0
+#define QUERY_NODE_AND 1
+#define QUERY_NODE_OR 2
+#define QUERY_NODE_NOT 3
+#define QUERY_MAX_NODES (2 * QUERY_MAX_PREDICATES)
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+    #include <direct.h>
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/wait.h>
+#endif
+
+/* ---------- Validation helpers ---------- */
+
+int is_alnum_char(char c) {
+    return isalpha((unsigned char)c) || isdigit((unsigned char)c);
+}
+
+// validate InspectionID: allowed letters A-Z (1 letter), digits 0-9 only (3 digits) and don't allow letters + 000,
+int is_valid_id(const char *id) {
+   if (strlen(id) != 4) return 0; 
+    if (!isupper(id[0])) return 0;
+    for (int i = 1; i < 4; i++) {
+        if (!isdigit(id[i])) return 0;
+    }
+    if (id[1] == '0' && id[2] == '0' && id[3] == '0') return 0;
+    return 1;
+}
+// validate CarRegNumber: allowed letters A-Z (3 letters) and digits 0-9 only (4 digits),
+int is_valid_car_reg(const char *reg) {
+    if (strlen(reg) != 7) return 0;
+    for (int i = 0; i < 3; i++) {
+        if (!isupper(reg[i])) return 0;
+    }
+    for (int i = 3; i < 7; i++) {
+        if (!isdigit(reg[i])) return 0;
+    }
+    if (reg[3] == '0' && reg[4] == '0' && reg[5] == '0' && reg[6] == '0') return 0;
+    return 1;
+}
+
+// OwnerName: letters and spaces only (no digits, no punctuation)
+int is_valid_owner_name(const char *s) {
+    if (!s) return 0;
+    size_t n = strlen(s);
+    if (n == 0 || n > OWNER_MAX_LEN) return 0;
+    int has_letter = 0;
+    for (size_t i = 0; i < n; ++i) {
+        char c = s[i];
+        if (isalpha((unsigned char)c)) has_letter = 1;
+        else if (c == ' ') continue;
+        else return 0;
+    }
+    return has_letter;
+}
+
+// check leap year
+int is_leap_year(int y) {
+    if (y % 400 == 0) return 1;
+    if (y % 100 == 0) return 0;
+    return (y % 4 == 0);
+}
+
+// validate date "DD/MM/YYYY", range DD valid per month, year MIN_YEAR..MAX_YEAR
+int is_valid_date(const char *s, char *normalized) {
+    if (!s || !normalized) return 0;
+
+    int d, m, y;
+    if (sscanf(s, "%d/%d/%d", &d, &m, &y) != 3) return 0;
+
+    if (y < MIN_YEAR || y > MAX_YEAR) return 0;
+    if (m < 1 || m > MONTHS_IN_YEAR) return 0;
+
+    int mdays;
+    if (m == 2) {
+        mdays = is_leap_year(y) ? DAYS_IN_FEBRUARY_LEAP : DAYS_IN_FEBRUARY_COMMON;
+    } else if (m == 4 || m == 6 || m == 9 || m == 11) {
+        mdays = DAYS_IN_MONTH_30;
+    } else {
+        mdays = DAYS_IN_MONTH_31;
+    }
+
+    if (d < 1 || d > mdays) return 0;
+    for (const char *p = s; *p; ++p) {
+        if (!isdigit((unsigned char)*p) && *p != '/' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') return 0;
+    }
+
+    snprintf(normalized, DATE_BUFFER_LEN, "%02d/%02d/%04d", d, m, y);
+    return 1;
+}
+
+/* ---------- Fast validators (bulk ingestion) ---------- */
+
+// Character classes of the C locale, so results never depend on setlocale()
+#define CC_UPPER 0x01
+#define CC_DIGIT 0x02
+#define CC_ALPHA 0x04
+#define CC_DATE_WS 0x08 // whitespace that both %d skips and is_valid_date's character pass allows
+#define CC_DATE 0x10    // any character is_valid_date accepts
+
+// ASCII rows written out (0x80 and up stay 0); short names only for this table
+#define U_ (CC_UPPER | CC_ALPHA)
+#define L_ CC_ALPHA
+#define D_ (CC_DIGIT | CC_DATE)
+#define S_ CC_DATE
+#define W_ (CC_DATE_WS | CC_DATE)
+static const unsigned char g_char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, W_, W_, 0, 0, W_, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    W_, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, S_, // 0x20
+    D_, D_, D_, D_, D_, D_, D_, D_, D_, D_, 0, 0, 0, 0, 0, 0, // 0x30
+    0, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, // 0x40
+    U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, 0, 0, 0, 0, 0, // 0x50
+    0, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, // 0x60
+    L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, 0, 0, 0, 0, 0, // 0x70
+};
+#undef U_
+#undef L_
+#undef D_
+#undef S_
+#undef W_
+
+// days per month, [is_leap][month]
+static const unsigned char g_month_days[2][MONTHS_IN_YEAR + 1] = {
+    { 0, DAYS_IN_MONTH_31, DAYS_IN_FEBRUARY_COMMON, DAYS_IN_MONTH_31, DAYS_IN_MONTH_30, DAYS_IN_MONTH_31, DAYS_IN_MONTH_30,
+      DAYS_IN_MONTH_31, DAYS_IN_MONTH_31, DAYS_IN_MONTH_30, DAYS_IN_MONTH_31, DAYS_IN_MONTH_30, DAYS_IN_MONTH_31 },
+    { 0, DAYS_IN_MONTH_31, DAYS_IN_FEBRUARY_LEAP, DAYS_IN_MONTH_31, DAYS_IN_MONTH_30, DAYS_IN_MONTH_31, DAYS_IN_MONTH_30,
+      DAYS_IN_MONTH_31, DAYS_IN_MONTH_31, DAYS_IN_MONTH_30, DAYS_IN_MONTH_31, DAYS_IN_MONTH_30, DAYS_IN_MONTH_31 },
+};
+
+#define CHAR_IS(c, cls) (g_char_class[(unsigned char)(c)] & (cls))
+
+int days_in_month(int m, int y) {
+    if (m < 1 || m > MONTHS_IN_YEAR) return 0;
+    return g_month_days[is_leap_year(y)][m];
+}
+
+int is_valid_id_fast(const char *id) {
+    if (!CHAR_IS(id[0], CC_UPPER) || !CHAR_IS(id[1], CC_DIGIT) ||
+        !CHAR_IS(id[2], CC_DIGIT) || !CHAR_IS(id[3], CC_DIGIT) || id[4] != '\0') return 0;
+    return !(id[1] == '0' && id[2] == '0' && id[3] == '0');
+}
+
+int is_valid_car_reg_fast(const char *reg) {
+    if (!CHAR_IS(reg[0], CC_UPPER) || !CHAR_IS(reg[1], CC_UPPER) || !CHAR_IS(reg[2], CC_UPPER) ||
+        !CHAR_IS(reg[3], CC_DIGIT) || !CHAR_IS(reg[4], CC_DIGIT) || !CHAR_IS(reg[5], CC_DIGIT) ||
+        !CHAR_IS(reg[6], CC_DIGIT) || reg[7] != '\0') return 0;
+    return !(reg[3] == '0' && reg[4] == '0' && reg[5] == '0' && reg[6] == '0');
+}
+
+int is_valid_owner_name_fast(const char *s) {
+    if (!s) return 0;
+    int has_letter = 0;
+    size_t i = 0;
+    for (; s[i]; ++i) {
+        if (i >= OWNER_MAX_LEN) return 0;
+        if (CHAR_IS(s[i], CC_ALPHA)) has_letter = 1;
+        else if (s[i] != ' ') return 0;
+    }
+    return has_letter;
+}
+
+// One "%d" the way sscanf reads it once is_valid_date's character pass has ruled out signs:
+// skip whitespace, take 1+ digits, convert like strtol (saturating at LONG_MAX) and narrow to int.
+static const char *scan_date_number(const char *p, int *out) {
+    while (CHAR_IS(*p, CC_DATE_WS)) p++;
+    if (!CHAR_IS(*p, CC_DIGIT)) return NULL;
+    unsigned long long v = 0;
+    for (; CHAR_IS(*p, CC_DIGIT); ++p) {
+        unsigned long long digit = (unsigned long long)(*p - '0');
+        if (v <= ((unsigned long long)LONG_MAX - digit) / 10) v = v * 10 + digit;
+        else v = (unsigned long long)LONG_MAX + 1; // out of range: strtol clamps
+    }
+    if (v > (unsigned long long)LONG_MAX) v = (unsigned long long)LONG_MAX;
+    *out = (int)(long)v;
+    return p;
+}
+
+static void write_normalized_date(char *out, int d, int m, int y) {
+    out[0] = (char)('0' + d / 10);
+    out[1] = (char)('0' + d % 10);
+    out[2] = '/';
+    out[3] = (char)('0' + m / 10);
+    out[4] = (char)('0' + m % 10);
+    out[5] = '/';
+    out[6] = (char)('0' + y / 1000);
+    out[7] = (char)('0' + y / 100 % 10);
+    out[8] = (char)('0' + y / 10 % 10);
+    out[9] = (char)('0' + y % 10);
+    out[10] = '\0';
+}
+
+// Same result and same normalized bytes as is_valid_date, without sscanf:
+// "DD/MM/YYYY" is decoded at fixed positions, anything else goes through a %d-compatible scanner.
+int is_valid_date_fast(const char *s, char *normalized) {
+    if (!s || !normalized) return 0;
+
+    int d, m, y;
+    if (CHAR_IS(s[0], CC_DIGIT) && CHAR_IS(s[1], CC_DIGIT) && s[2] == '/' &&
+        CHAR_IS(s[3], CC_DIGIT) && CHAR_IS(s[4], CC_DIGIT) && s[5] == '/' &&
+        CHAR_IS(s[6], CC_DIGIT) && CHAR_IS(s[7], CC_DIGIT) && CHAR_IS(s[8], CC_DIGIT) &&
+        CHAR_IS(s[9], CC_DIGIT) && !CHAR_IS(s[10], CC_DIGIT)) {
+        d = (s[0] - '0') * 10 + (s[1] - '0');
+        m = (s[3] - '0') * 10 + (s[4] - '0');
+        y = (s[6] - '0') * 1000 + (s[7] - '0') * 100 + (s[8] - '0') * 10 + (s[9] - '0');
+    } else {
+        const char *p = scan_date_number(s, &d);
+        if (!p || *p != '/') return 0;
+        p = scan_date_number(p + 1, &m);
+        if (!p || *p != '/') return 0;
+        p = scan_date_number(p + 1, &y);
+        if (!p) return 0;
+    }
+
+    if (y < MIN_YEAR || y > MAX_YEAR) return 0;
+    if (m < 1 || m > MONTHS_IN_YEAR) return 0;
+    if (d < 1 || d > g_month_days[is_leap_year(y)][m]) return 0;
+    for (const char *p = s; *p; ++p) {
+        if (!CHAR_IS(*p, CC_DATE)) return 0;
+    }
+
+    write_normalized_date(normalized, d, m, y);
+    return 1;
+}
+
+// Validate n candidate rows at once: flags[i] gets VALID_* bits for rows[i]; when
+// normalized_dates is not NULL it receives each valid date in DD/MM/YYYY form.
+// Returns the number of rows with every field valid.
+int validate_records_batch(const Record *rows, int n, unsigned char *flags, char (*normalized_dates)[DATE_BUFFER_LEN]) {
+    int all_valid = 0;
+    for (int i = 0; i < n; ++i) {
+        char scratch[DATE_BUFFER_LEN];
+        char *norm = normalized_dates ? normalized_dates[i] : scratch;
+        unsigned char f = 0;
+        if (is_valid_id_fast(rows[i].inspectionID)) f |= VALID_ID;
+        if (is_valid_car_reg_fast(rows[i].carReg)) f |= VALID_CAR_REG;
+        if (is_valid_owner_name_fast(rows[i].owner)) f |= VALID_OWNER;
+        if (is_valid_date_fast(rows[i].date, norm)) f |= VALID_DATE;
+        flags[i] = f;
+        if (f == VALID_ALL) all_valid++;
+    }
+    return all_valid;
+}
+
+void trim_whitespace(char *str) {
+    if (!str) return;
+    // Trim leading
+    char *start = str;
+    while (isspace((unsigned char)*start)) start++;
+    memmove(str, start, strlen(start) + 1);
+
+    // Trim trailing
+    char *end = str + strlen(str) - 1;
+    while (end >= str && isspace((unsigned char)*end)) *end-- = '\0';
+}
+
+// days since 01/01/0000 in the proleptic Gregorian calendar
+static long days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    long era = y / 400;
+    long yoe = y - era * 400;
+    long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy;
+}
+
+// days before month m, [is_leap][month]
+static const unsigned short g_month_first_day[2][MONTHS_IN_YEAR + 1] = {
+    { 0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 },
+    { 0, 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335 },
+};
+
+static uint32_t g_year_first_day[MAX_YEAR - MIN_YEAR + 2]; // day number of 01/01 of each year
+static uint16_t g_day_month[REPORT_YEARS * 366]; // day number -> (year - MIN_YEAR) * 12 + month - 1
+static pthread_once_t g_year_table_once = PTHREAD_ONCE_INIT;
+
+static void year_table_init(void) {
+    long base = days_from_civil(MIN_YEAR, 1, 1);
+    for (int y = MIN_YEAR; y <= MAX_YEAR + 1; ++y) g_year_first_day[y - MIN_YEAR] = (uint32_t)(days_from_civil(y, 1, 1) - base);
+    uint32_t day = 0;
+    for (int y = 0; y < REPORT_YEARS; ++y)
+        for (int m = 1; m <= MONTHS_IN_YEAR; ++m)
+            for (int d = days_in_month(m, MIN_YEAR + y); d > 0; --d) g_day_month[day++] = (uint16_t)(y * MONTHS_IN_YEAR + m - 1);
+}
+
+// month slot (0..REPORT_MONTHS-1) of a date_day_number; -1 outside MIN_YEAR..MAX_YEAR
+int day_month_index(uint32_t day) {
+    pthread_once(&g_year_table_once, year_table_init);
+    return day < g_year_first_day[REPORT_YEARS] ? g_day_month[day] : -1;
+}
+
+// days since 01/01/MIN_YEAR for a DD/MM/YYYY date; unparseable dates sort last
+uint32_t date_day_number(const char *s) {
+    if (!(CHAR_IS(s[0], CC_DIGIT) && CHAR_IS(s[1], CC_DIGIT) && s[2] == '/' &&
+          CHAR_IS(s[3], CC_DIGIT) && CHAR_IS(s[4], CC_DIGIT) && s[5] == '/' &&
+          CHAR_IS(s[6], CC_DIGIT) && CHAR_IS(s[7], CC_DIGIT) && CHAR_IS(s[8], CC_DIGIT) &&
+          CHAR_IS(s[9], CC_DIGIT) && s[10] == '\0')) {
+        // hand-typed layouts ("1/8/2025") go through the full validator first
+        char norm[DATE_BUFFER_LEN];
+        if (!is_valid_date_fast(s, norm)) return UINT32_MAX;
+        return date_day_number(norm);
+    }
+    int d = (s[0] - '0') * 10 + (s[1] - '0');
+    int m = (s[3] - '0') * 10 + (s[4] - '0');
+    int y = (s[6] - '0') * 1000 + (s[7] - '0') * 100 + (s[8] - '0') * 10 + (s[9] - '0');
+    if (y < MIN_YEAR || m < 1 || m > MONTHS_IN_YEAR || d < 1 || d > days_in_month(m, y)) return UINT32_MAX;
+    if (y > MAX_YEAR) return (uint32_t)(days_from_civil(y, m, d) - days_from_civil(MIN_YEAR, 1, 1));
+    pthread_once(&g_year_table_once, year_table_init);
+    const uint32_t *year = &g_year_first_day[y - MIN_YEAR];
+    int leap = year[1] - year[0] == 366;
+    return year[0] + g_month_first_day[leap][m] + (uint32_t)(d - 1);
+}
+
+/* ---------- Platform helpers ---------- */
+
+int cpu_count(void) {
+#if defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int n = (int)info.dwNumberOfProcessors;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) n = 1;
+    if (n > THREAD_POOL_MAX_WORKERS) n = THREAD_POOL_MAX_WORKERS;
+    return n;
+}
+
+// monotonic clock in milliseconds, for benchmarks and timings
+double now_ms(void) {
+#if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart * 1000.0 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+// flush a file's data to stable storage; 1 on success
+int file_sync(const char *path) {
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE h = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return 0;
+    int ok = FlushFileBuffers(h) != 0;
+    CloseHandle(h);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = fsync(fd) == 0;
+    close(fd);
+#endif
+    return ok;
+}
+
+// append len bytes to path and flush them to stable storage (fdatasync where available);
+// *start = the offset they landed at
+int file_append_sync(const char *path, const char *buf, size_t len, unsigned long long *start) {
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE h = CreateFileA(path, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER size;
+    DWORD written = 0;
+    int ok = GetFileSizeEx(h, &size) != 0;
+    *start = ok ? (unsigned long long)size.QuadPart : 0;
+    ok = ok && WriteFile(h, buf, (DWORD)len, &written, NULL) && written == len && FlushFileBuffers(h);
+    CloseHandle(h);
+#else
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) return 0;
+    off_t end = lseek(fd, 0, SEEK_END);
+    *start = end < 0 ? 0 : (unsigned long long)end;
+    size_t off = 0;
+    while (off < len) {
+        ssize_t w = write(fd, buf + off, len - off);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) break;
+        off += (size_t)w;
+    }
+    int ok = end >= 0 && off == len;
+#if defined(__linux__)
+    ok = ok && fdatasync(fd) == 0; // the data, not the mtime
+#else
+    ok = ok && fsync(fd) == 0;
+#endif
+    close(fd);
+#endif
+    return ok;
+}
+
+// block the calling thread for ms milliseconds
+void sleep_ms(double ms) {
+    if (ms <= 0) return;
+#if defined(_WIN32) || defined(_WIN64)
+    Sleep((DWORD)(ms + 0.5));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ms / 1000);
+    ts.tv_nsec = (long)((ms - ts.tv_sec * 1000.0) * 1e6);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+#endif
+}
+
+// replace path with tmp (rename does not replace an existing file on Windows); 1 on success
+int file_replace(const char *tmp, const char *path) {
+#if defined(_WIN32) || defined(_WIN64)
+    return MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(tmp, path) == 0;
+#endif
+}
+
+// flush the directory holding path, so a file_replace into it survives a crash; 1 on success
+int dir_sync(const char *path) {
+#if defined(_WIN32) || defined(_WIN64)
+    (void)path; // file_replace writes the rename through already
+    return 1;
+#else
+    char dir[MAX_LINE];
+    const char *slash = strrchr(path, '/');
+    if (!slash) strcpy(dir, ".");
+    else if (slash == path) strcpy(dir, "/");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
+// create directory path; 1 if it exists afterwards
+int make_dir(const char *path) {
+#if defined(_WIN32) || defined(_WIN64)
+    int rc = _mkdir(path);
+#else
+    int rc = mkdir(path, 0755);
+#endif
+    return rc == 0 || errno == EEXIST;
+}
+
+// remove an empty directory; 1 on success
+int dir_remove(const char *path) {
+#if defined(_WIN32) || defined(_WIN64)
+    return _rmdir(path) == 0;
+#else
+    return rmdir(path) == 0;
+#endif
+}
+
+// fseek to a 64-bit offset from the start of f
+int file_seek(FILE *f, unsigned long long off) {
+#if defined(_WIN32) || defined(_WIN64)
+    return _fseeki64(f, (long long)off, SEEK_SET);
+#else
+    return fseeko(f, (off_t)off, SEEK_SET);
+#endif
+}
+
+/* ---------- Scratch arena (per-operation temporary memory) ---------- */
+
+// Bump allocator for data that only lives until the current operation (a menu action, an
+// API call) ends: search results, merge buffers, formatted output. One thread owns an arena.
+struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+};
+
+#define ARENA_BLOCK_HEADER (((sizeof(ArenaBlock) + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN)
+
+void arena_init(Arena *arena) {
+    memset(arena, 0, sizeof(*arena));
+}
+
+void arena_free(Arena *arena) {
+    ArenaBlock *b = arena->head;
+    while (b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    arena->head = NULL;
+    arena->used = 0;
+    arena->reserved = 0;
+}
+
+static ArenaBlock *arena_new_block(Arena *arena, size_t size) {
+    ArenaBlock *b = malloc(ARENA_BLOCK_HEADER + size);
+    if (!b) return NULL;
+    b->size = size;
+    b->used = 0;
+    b->next = arena->head;
+    arena->head = b;
+    arena->reserved += size;
+    arena->block_mallocs++;
+    return b;
+}
+
+// size bytes aligned to ARENA_ALIGN, valid until the next arena_reset; NULL if out of memory
+void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (size == 0) size = ARENA_ALIGN;
+    ArenaBlock *b = arena->head;
+    if (!b || b->size - b->used < size) {
+        size_t want = arena->reserved > ARENA_BLOCK_SIZE ? arena->reserved : ARENA_BLOCK_SIZE;
+        b = arena_new_block(arena, size > want ? size : want);
+        if (!b) return NULL;
+    }
+    void *p = (char *)b + ARENA_BLOCK_HEADER + b->used;
+    b->used += size;
+    arena->used += size;
+    arena->allocs++;
+    if (arena->used > arena->peak) arena->peak = arena->used;
+    return p;
+}
+
+// forget everything allocated; an arena that spilled into several blocks is
+// replaced by one block of the combined size, so the next operation never mallocs
+void arena_reset(Arena *arena) {
+    if (arena->head && arena->head->next) {
+        size_t total = arena->reserved;
+        arena_free(arena);
+        arena_new_block(arena, total);
+    }
+    if (arena->head) arena->head->used = 0;
+    arena->last_used = arena->used;
+    arena->last_allocs = arena->allocs;
+    arena->used = 0;
+    arena->allocs = 0;
+    arena->resets++;
+}
+
+/* ---------- Work-stealing thread pool ---------- */
+
+// A batch of tasks the submitter can wait on
+struct TaskGroup {
+    atomic_int remaining;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+};
+
+typedef struct {
+    TaskFn fn;
+    void *arg;
+    TaskGroup *group;
+} Task;
+
+// Each worker owns one deque: the owner pushes/pops at the bottom, thieves take from the top.
+typedef struct {
+    Task *buf;
+    int capacity;
+    int top;
+    int bottom;
+    pthread_mutex_t lock;
+} TaskDeque;
+
+typedef struct {
+    ThreadPool *pool;
+    int index;
+} WorkerArg;
+
+struct ThreadPool {
+    pthread_t *threads;
+    WorkerArg *args;
+    TaskDeque *deques;
+    int nworkers;
+    atomic_int pending;       // tasks queued but not yet taken
+    atomic_uint next_deque;   // round-robin target for external submits
+    int shutdown;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+};
+
+static _Thread_local ThreadPool *tls_worker_pool = NULL;
+static _Thread_local int tls_worker_index = -1;
+
+static int deque_init(TaskDeque *dq) {
+    dq->buf = malloc(sizeof(Task) * TASK_DEQUE_INITIAL_CAPACITY);
+    if (!dq->buf) return 0;
+    dq->capacity = TASK_DEQUE_INITIAL_CAPACITY;
+    dq->top = dq->bottom = 0;
+    pthread_mutex_init(&dq->lock, NULL);
+    return 1;
+}
+
+static void deque_destroy(TaskDeque *dq) {
+    pthread_mutex_destroy(&dq->lock);
+    free(dq->buf);
+}
+
+static int deque_push_bottom(TaskDeque *dq, Task t) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom - dq->top == dq->capacity) {
+        int newcap = dq->capacity * 2;
+        Task *nb = malloc(sizeof(Task) * newcap);
+        if (!nb) {
+            pthread_mutex_unlock(&dq->lock);
+            return 0;
+        }
+        for (int i = dq->top; i < dq->bottom; ++i) nb[i - dq->top] = dq->buf[i % dq->capacity];
+        dq->bottom -= dq->top;
+        dq->top = 0;
+        free(dq->buf);
+        dq->buf = nb;
+        dq->capacity = newcap;
+    }
+    dq->buf[dq->bottom % dq->capacity] = t;
+    dq->bottom++;
+    pthread_mutex_unlock(&dq->lock);
+    return 1;
+}
+
+static int deque_pop_bottom(TaskDeque *dq, Task *out) {
+    int ok = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom > dq->top) {
+        dq->bottom--;
+        *out = dq->buf[dq->bottom % dq->capacity];
+        ok = 1;
+        if (dq->bottom == dq->top) dq->top = dq->bottom = 0;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return ok;
+}
+
+static int deque_steal_top(TaskDeque *dq, Task *out) {
+    int ok = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom > dq->top) {
+        *out = dq->buf[dq->top % dq->capacity];
+        dq->top++;
+        ok = 1;
+        if (dq->bottom == dq->top) dq->top = dq->bottom = 0;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return ok;
+}
+
+// own deque first (LIFO, cache-warm), then steal oldest work from the others
+static int pool_try_take(ThreadPool *pool, int self, Task *out) {
+    if (self >= 0 && deque_pop_bottom(&pool->deques[self], out)) {
+        atomic_fetch_sub(&pool->pending, 1);
+        return 1;
+    }
+    int start = (int)(atomic_fetch_add(&pool->next_deque, 1) % (unsigned)pool->nworkers);
+    for (int k = 0; k < pool->nworkers; ++k) {
+        int victim = (start + k) % pool->nworkers;
+        if (victim == self) continue;
+        if (deque_steal_top(&pool->deques[victim], out)) {
+            atomic_fetch_sub(&pool->pending, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void run_task(Task *t) {
+    t->fn(t->arg);
+    TaskGroup *g = t->group;
+    if (!g) return;
+    // decrement under the lock: the waiter may destroy g as soon as it can take the
+    // lock after seeing zero, so the last touch of g must be this unlock
+    pthread_mutex_lock(&g->lock);
+    if (atomic_fetch_sub(&g->remaining, 1) == 1) pthread_cond_broadcast(&g->done);
+    pthread_mutex_unlock(&g->lock);
+}
+
+static void *worker_main(void *p) {
+    WorkerArg *wa = p;
+    ThreadPool *pool = wa->pool;
+    tls_worker_pool = pool;
+    tls_worker_index = wa->index;
+
+    while (1) {
+        Task t;
+        if (pool_try_take(pool, wa->index, &t)) {
+            run_task(&t);
+            continue;
+        }
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shutdown && atomic_load(&pool->pending) == 0) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        int quit = pool->shutdown && atomic_load(&pool->pending) == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (quit) break;
+    }
+    return NULL;
+}
+
+// create a pool with nworkers threads; returns NULL if threads cannot be started
+ThreadPool *thread_pool_create(int nworkers) {
+    if (nworkers < 1) nworkers = 1;
+    if (nworkers > THREAD_POOL_MAX_WORKERS) nworkers = THREAD_POOL_MAX_WORKERS;
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->threads = calloc(nworkers, sizeof(pthread_t));
+    pool->args = calloc(nworkers, sizeof(WorkerArg));
+    pool->deques = calloc(nworkers, sizeof(TaskDeque));
+    if (!pool->threads || !pool->args || !pool->deques) {
+        free(pool->threads);
+        free(pool->args);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->next_deque, 0);
+
+    int ready = 0;
+    while (ready < nworkers && deque_init(&pool->deques[ready])) ready++;
+    // workers steal from every deque, so all of them exist and the count is
+    // published before the first worker runs
+    pool->nworkers = ready;
+    int started = 0;
+    if (ready == nworkers) {
+        for (; started < nworkers; ++started) {
+            pool->args[started].pool = pool;
+            pool->args[started].index = started;
+            if (pthread_create(&pool->threads[started], NULL, worker_main, &pool->args[started]) != 0) break;
+        }
+    }
+    if (started < nworkers) {
+        pthread_mutex_lock(&pool->lock);
+        pool->shutdown = 1;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+        for (int i = 0; i < started; ++i) pthread_join(pool->threads[i], NULL);
+        for (int i = 0; i < ready; ++i) deque_destroy(&pool->deques[i]);
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->wake);
+        free(pool->threads);
+        free(pool->args);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->nworkers; ++i) {
+        pthread_join(pool->threads[i], NULL);
+        deque_destroy(&pool->deques[i]);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->threads);
+    free(pool->args);
+    free(pool->deques);
+    free(pool);
+}
+
+// threads working on a scan: the pool's workers plus the caller, which helps while it waits
+int scan_thread_count(const ThreadPool *pool) {
+    return pool ? pool->nworkers + 1 : 1;
+}
+
+void task_group_init(TaskGroup *g) {
+    atomic_init(&g->remaining, 0);
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->done, NULL);
+}
+
+void task_group_destroy(TaskGroup *g) {
+    pthread_mutex_destroy(&g->lock);
+    pthread_cond_destroy(&g->done);
+}
+
+// queue fn(arg) as part of group g; runs inline if the task cannot be queued
+void thread_pool_submit(ThreadPool *pool, TaskGroup *g, TaskFn fn, void *arg) {
+    Task t = { fn, arg, g };
+    if (g) atomic_fetch_add(&g->remaining, 1);
+
+    int target;
+    if (tls_worker_pool == pool && tls_worker_index >= 0) {
+        target = tls_worker_index;
+    } else {
+        target = (int)(atomic_fetch_add(&pool->next_deque, 1) % (unsigned)pool->nworkers);
+    }
+    if (!deque_push_bottom(&pool->deques[target], t)) {
+        run_task(&t);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add(&pool->pending, 1);
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// block until every task in g finished; the waiting thread helps by running queued tasks
+void task_group_wait(ThreadPool *pool, TaskGroup *g) {
+    int self = (tls_worker_pool == pool) ? tls_worker_index : -1;
+    while (atomic_load(&g->remaining) > 0) {
+        Task t;
+        if (pool_try_take(pool, self, &t)) {
+            run_task(&t);
+            continue;
+        }
+        pthread_mutex_lock(&g->lock);
+        while (atomic_load(&g->remaining) > 0) pthread_cond_wait(&g->done, &g->lock);
+        pthread_mutex_unlock(&g->lock);
+    }
+    // the last task may still hold g->lock after its decrement; wait it out so the
+    // caller can destroy g
+    pthread_mutex_lock(&g->lock);
+    pthread_mutex_unlock(&g->lock);
+}
+
+static ThreadPool *g_scan_pool = NULL;
+static pthread_once_t g_scan_pool_once = PTHREAD_ONCE_INIT;
+
+static void scan_pool_create(void) {
+    int n = cpu_count();
+    if (n > 1) g_scan_pool = thread_pool_create(n - 1);
+}
+
+// shared pool used by the scan paths; NULL on single-core machines
+ThreadPool *scan_pool(void) {
+    pthread_once(&g_scan_pool_once, scan_pool_create);
+    return g_scan_pool;
+}
+
+/* ---------- Parallel scan ---------- */
+
+typedef struct {
+    ScanChunkFn fn;
+    void *ctx;
+    void *out;
+    int begin;
+    int end;
+} ScanChunkTask;
+
+static void scan_chunk_task(void *arg) {
+    ScanChunkTask *t = arg;
+    t->fn(t->begin, t->end, t->ctx, t->out);
+}
+
+int scan_chunk_rows(const ThreadPool *pool, int n) {
+    int parts = scan_thread_count(pool) * SCAN_CHUNKS_PER_WORKER;
+    int rows = (n + parts - 1) / parts;
+    return rows < SCAN_MIN_CHUNK_ROWS ? SCAN_MIN_CHUNK_ROWS : rows;
+}
+
+int scan_chunk_count(const ThreadPool *pool, int n) {
+    if (n <= 0) return 0;
+    int rows = scan_chunk_rows(pool, n);
+    return (n + rows - 1) / rows;
+}
+
+// Split [0, n) into scan_chunk_count() chunks and run fn on each, chunk i writing
+// to outs + i * out_size. Callers merge outs in chunk order to keep row order.
+// With pool == NULL the chunks run one after another on the calling thread.
+int parallel_scan(ThreadPool *pool, int n, ScanChunkFn fn, void *ctx, void *outs, size_t out_size) {
+    int chunks = scan_chunk_count(pool, n);
+    if (chunks == 0) return 0;
+    int rows = scan_chunk_rows(pool, n);
+    char *out_base = outs;
+
+    // chunks never exceeds SCAN_MAX_CHUNKS, so the task records live on the stack
+    ScanChunkTask tasks[SCAN_MAX_CHUNKS];
+    if (!pool || chunks == 1 || chunks > SCAN_MAX_CHUNKS) {
+        for (int c = 0; c < chunks; ++c) {
+            int end = (c + 1) * rows < n ? (c + 1) * rows : n;
+            fn(c * rows, end, ctx, out_base ? out_base + (size_t)c * out_size : NULL);
+        }
+        return chunks;
+    }
+
+    TaskGroup group;
+    task_group_init(&group);
+    for (int c = 0; c < chunks; ++c) {
+        tasks[c].fn = fn;
+        tasks[c].ctx = ctx;
+        tasks[c].out = out_base ? out_base + (size_t)c * out_size : NULL;
+        tasks[c].begin = c * rows;
+        tasks[c].end = (c + 1) * rows < n ? (c + 1) * rows : n;
+        thread_pool_submit(pool, &group, scan_chunk_task, &tasks[c]);
+    }
+    task_group_wait(pool, &group);
+    task_group_destroy(&group);
+    return chunks;
+}
+
+typedef struct {
+    RowPredicate pred;
+    void *ctx;
+    atomic_int best; // lowest matching row seen so far, n if none
+} FindFirstCtx;
+
+static void find_first_chunk(int begin, int end, void *ctx, void *out) {
+    (void)out;
+    FindFirstCtx *f = ctx;
+    for (int i = begin; i < end; ++i) {
+        // a hit in an earlier chunk makes the rest of this one irrelevant
+        if ((i & 1023) == 0 && i >= atomic_load_explicit(&f->best, memory_order_relaxed)) return;
+        if (f->pred(i, f->ctx)) {
+            int cur = atomic_load(&f->best);
+            while (i < cur && !atomic_compare_exchange_weak(&f->best, &cur, i)) {}
+            return;
+        }
+    }
+}
+
+// lowest row index in [0, n) matching pred, or -1
+int parallel_find_first(ThreadPool *pool, int n, RowPredicate pred, void *ctx) {
+    FindFirstCtx f;
+    f.pred = pred;
+    f.ctx = ctx;
+    atomic_init(&f.best, n);
+    parallel_scan(pool, n, find_first_chunk, &f, NULL, 0);
+    int best = atomic_load(&f.best);
+    return best < n ? best : -1;
+}
+
+typedef struct {
+    RowPredicate pred;
+    void *ctx;
+} CollectCtx;
+
+// append row to list; on allocation failure mark the list with count -1 and return 0
+int index_list_push(IndexList *list, int row) {
+    if (list->count == list->capacity) {
+        int newcap = list->capacity ? list->capacity * 2 : 16;
+        int *p = realloc(list->idx, sizeof(int) * newcap);
+        if (!p) {
+            list->count = -1;
+            return 0;
+        }
+        list->idx = p;
+        list->capacity = newcap;
+    }
+    list->idx[list->count++] = row;
+    return 1;
+}
+
+static void collect_chunk(int begin, int end, void *ctx, void *out) {
+    CollectCtx *c = ctx;
+    IndexList *list = out;
+    for (int i = begin; i < end; ++i) {
+        if (c->pred(i, c->ctx) && !index_list_push(list, i)) return;
+    }
+}
+
+int merge_index_lists(IndexList *lists, int chunks, Arena *arena, int **out_idx);
+
+// per-chunk result lists for a scan, zeroed, from the caller's arena
+static IndexList *index_lists_alloc(Arena *arena, int chunks) {
+    IndexList *lists = arena_alloc(arena, sizeof(IndexList) * chunks);
+    if (lists) memset(lists, 0, sizeof(IndexList) * chunks);
+    return lists;
+}
+
+// collect every matching row index, in row order, into an array from arena (*out_idx);
+// returns the number of matches or -1 when out of memory
+int parallel_collect(ThreadPool *pool, int n, RowPredicate pred, void *ctx, Arena *arena, int **out_idx) {
+    *out_idx = NULL;
+    int chunks = scan_chunk_count(pool, n);
+    if (chunks == 0) return 0;
+    IndexList *lists = index_lists_alloc(arena, chunks);
+    if (!lists) return -1;
+
+    CollectCtx c = { pred, ctx };
+    parallel_scan(pool, n, collect_chunk, &c, lists, sizeof(IndexList));
+    return merge_index_lists(lists, chunks, arena, out_idx);
+}
+
+// concatenate per-chunk lists in chunk order into one arena array and free their buffers
+// (those were grown by the workers, which cannot share the caller's arena)
+int merge_index_lists(IndexList *lists, int chunks, Arena *arena, int **out_idx) {
+    int total = 0;
+    for (int i = 0; i < chunks; ++i) {
+        if (lists[i].count < 0) total = -1;
+        if (total >= 0) total += lists[i].count;
+    }
+    int *merged = (total > 0) ? arena_alloc(arena, sizeof(int) * total) : NULL;
+    if (total > 0 && !merged) total = -1;
+    int pos = 0;
+    for (int i = 0; i < chunks; ++i) {
+        if (total > 0 && lists[i].count > 0) {
+            memcpy(merged + pos, lists[i].idx, sizeof(int) * lists[i].count);
+            pos += lists[i].count;
+        }
+        free(lists[i].idx);
+    }
+    *out_idx = merged;
+    return total;
+}
+
+/* ---------- Search / Find ---------- */
+
+// case-insensitive exact match against InspectionID or CarRegNumber
+int row_matches_key(int row, void *ctx) {
+    const KeyMatchCtx *c = ctx;
+    return strcasecmp(c->rows[row].inspectionID, c->key) == 0 ||
+           strcasecmp(c->rows[row].carReg, c->key) == 0;
+}
+
+int find_case_insensitive(Record *arr, int n, const char *key) {
+    if (n > PARALLEL_SCAN_THRESHOLD) {
+        KeyMatchCtx ctx = { arr, key };
+        return parallel_find_first(scan_pool(), n, row_matches_key, &ctx);
+    }
+    for (int i = 0; i < n; i++) {
+        if (strcasecmp(arr[i].inspectionID, key) == 0 ||
+            strcasecmp(arr[i].carReg, key) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// next field of *cursor, cut the way strtok(..., ",") would (empty fields are skipped), but
+// without strtok's hidden state, so any number of threads can parse at once
+static char *next_csv_field(char **cursor) {
+    char *s = *cursor + strspn(*cursor, ",");
+    if (!*s) return NULL;
+    char *end = s + strcspn(s, ",");
+    *cursor = *end ? end + 1 : end;
+    *end = '\0';
+    return s;
+}
+
+// split one CSV line (newline already stripped) into r; return 0 if it has fewer than 4 fields
+int parse_record_line(char *line, Record *r) {
+    char *tk, *cursor = line;
+    tk = next_csv_field(&cursor);
+    if (!tk) return 0;
+    strncpy(r->inspectionID, tk, sizeof(r->inspectionID) - 1);
+    r->inspectionID[sizeof(r->inspectionID) - 1] = 0;
+    trim_whitespace(r->inspectionID);
+
+    tk = next_csv_field(&cursor);
+    if (!tk) return 0;
+    strncpy(r->carReg, tk, sizeof(r->carReg) - 1);
+    r->carReg[sizeof(r->carReg) - 1] = 0;
+    trim_whitespace(r->carReg);
+
+    tk = next_csv_field(&cursor);
+    if (!tk) return 0;
+    strncpy(r->owner, tk, sizeof(r->owner) - 1);
+    r->owner[sizeof(r->owner) - 1] = 0;
+    trim_whitespace(r->owner);
+
+    tk = next_csv_field(&cursor);
+    if (!tk) return 0;
+    strncpy(r->date, tk, sizeof(r->date) - 1);
+    r->date[sizeof(r->date) - 1] = 0;
+    trim_whitespace(r->date);
+    return 1;
+}
+
+// strip trailing "\n" / "\r"; return 0 for blank lines
+int strip_line_ending(char *line) {
+    char *p = strchr(line, '\n');
+    if (p) *p = '\0';
+    p = strchr(line, '\r');
+    if (p) *p = '\0';
+    return line[0] != '\0';
+}
+
+/* ---------- Key column compare kernel ---------- */
+
+// bitmask of rows [0, KEY_BLOCK_ROWS) whose id or reg slot matches the query
+typedef uint32_t (*KeyMatchBlockFn)(const KeySlot *ids, const KeySlot *regs, const KeyQuery *q);
+
+static unsigned char fold_upper(unsigned char c) {
+    // strcasecmp in the C locale only folds ASCII letters
+    return (c >= 'a' && c <= 'z') ? (unsigned char)(c - ('a' - 'A')) : c;
+}
+
+void key_slot_set(KeySlot *k, const char *s) {
+    size_t len = strlen(s);
+    if (len > KEY_SLOT_LEN) {
+        memset(k->b, KEY_SLOT_OVERFLOW, KEY_SLOT_LEN);
+        return;
+    }
+    memset(k->b, 0, KEY_SLOT_LEN);
+    for (size_t i = 0; i < len; ++i) k->b[i] = fold_upper((unsigned char)s[i]);
+}
+
+static int key_slot_is_overflow(const KeySlot *k) {
+    for (int i = 0; i < KEY_SLOT_LEN; ++i) {
+        if (k->b[i] != KEY_SLOT_OVERFLOW) return 0;
+    }
+    return 1;
+}
+
+void key_query_init(KeyQuery *q, const char *key) {
+    q->key = key;
+    key_slot_set(&q->folded, key);
+    // long keys (and the one short key that looks like the sentinel) can only match
+    // overflow slots, so search for those and let the caller confirm each candidate
+    q->verify = key_slot_is_overflow(&q->folded);
+}
+
+static uint64_t key_slot_word(const KeySlot *k) {
+    uint64_t w;
+    memcpy(&w, k->b, sizeof(w));
+    return w;
+}
+
+int key_slot_matches(const KeySlot *k, const KeyQuery *q) {
+    return key_slot_word(k) == key_slot_word(&q->folded);
+}
+
+static uint32_t key_match_block_scalar(const KeySlot *ids, const KeySlot *regs, const KeyQuery *q) {
+    uint64_t want = key_slot_word(&q->folded);
+    uint32_t mask = 0;
+    for (int i = 0; i < KEY_BLOCK_ROWS; ++i) {
+        if (key_slot_word(&ids[i]) == want || key_slot_word(&regs[i]) == want) mask |= 1u << i;
+    }
+    return mask;
+}
+
+// nonzero if any byte of the movemask word x is 0xFF, i.e. some slot compared equal on all 8 bytes
+static uint64_t any_full_byte(uint64_t x) {
+    uint64_t inv = ~x;
+    return (inv - 0x0101010101010101ULL) & ~inv & 0x8080808080808080ULL;
+}
+
+// rows of a block whose slot bytes all compared equal; e holds `per` id groups then `per` reg groups
+static uint32_t full_groups_to_rows(uint64_t e, int per) {
+    uint32_t rows = 0;
+    for (int k = 0; k < per; ++k) {
+        if (((e >> (8 * k)) & 0xFF) == 0xFF || ((e >> (8 * (k + per))) & 0xFF) == 0xFF) rows |= 1u << k;
+    }
+    return rows;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// Both kernels first OR together a cheap "some row in this block may match" test and
+// only build the exact row mask when it fires, since nearly every row is a miss.
+
+// two rows per 16-byte load: the column is contiguous, so slots i and i+1 are adjacent
+__attribute__((target("sse2")))
+static uint32_t key_match_block_sse2(const KeySlot *ids, const KeySlot *regs, const KeyQuery *q) {
+    __m128i want = _mm_set1_epi64x((long long)key_slot_word(&q->folded));
+    uint32_t eq[KEY_BLOCK_ROWS / 2];
+    uint64_t any = 0;
+    for (int i = 0; i < KEY_BLOCK_ROWS; i += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i *)ids[i].b);
+        __m128i b = _mm_loadu_si128((const __m128i *)regs[i].b);
+        __m128i ea = _mm_cmpeq_epi8(a, want);
+        __m128i eb = _mm_cmpeq_epi8(b, want);
+        eq[i / 2] = (uint32_t)_mm_movemask_epi8(ea) | ((uint32_t)_mm_movemask_epi8(eb) << 16);
+        any |= any_full_byte(eq[i / 2]);
+    }
+    if (!any) return 0;
+    uint32_t mask = 0;
+    for (int i = 0; i < KEY_BLOCK_ROWS; i += 2) mask |= full_groups_to_rows(eq[i / 2], 2) << i;
+    return mask;
+}
+
+// four rows per 32-byte load
+__attribute__((target("avx2")))
+static uint32_t key_match_block_avx2(const KeySlot *ids, const KeySlot *regs, const KeyQuery *q) {
+    __m256i want = _mm256_set1_epi64x((long long)key_slot_word(&q->folded));
+    uint64_t eq[KEY_BLOCK_ROWS / 4];
+    uint64_t any = 0;
+    for (int i = 0; i < KEY_BLOCK_ROWS; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)ids[i].b);
+        __m256i b = _mm256_loadu_si256((const __m256i *)regs[i].b);
+        __m256i ea = _mm256_cmpeq_epi8(a, want);
+        __m256i eb = _mm256_cmpeq_epi8(b, want);
+        uint64_t e = (uint32_t)_mm256_movemask_epi8(ea) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(eb) << 32);
+        eq[i / 4] = e;
+        any |= any_full_byte(e);
+    }
+    if (!any) return 0;
+    uint32_t mask = 0;
+    for (int i = 0; i < KEY_BLOCK_ROWS; i += 4) mask |= full_groups_to_rows(eq[i / 4], 4) << i;
+    return mask;
+}
+#endif
+
+static KeyMatchBlockFn g_key_match_block = NULL;
+static const char *g_key_kernel_name = "scalar";
+static pthread_once_t g_key_kernel_once = PTHREAD_ONCE_INIT;
+
+static void key_kernel_select(void) {
+    g_key_match_block = key_match_block_scalar;
+    g_key_kernel_name = "scalar";
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        g_key_match_block = key_match_block_avx2;
+        g_key_kernel_name = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        g_key_match_block = key_match_block_sse2;
+        g_key_kernel_name = "sse2";
+    }
+#endif
+}
+
+// name of the kernel picked for this CPU ("avx2", "sse2" or "scalar")
+const char *key_kernel_name(void) {
+    pthread_once(&g_key_kernel_once, key_kernel_select);
+    return g_key_kernel_name;
+}
+
+// force a kernel by name (benchmarks / tests); returns 0 if unavailable here
+int key_kernel_use(const char *name) {
+    pthread_once(&g_key_kernel_once, key_kernel_select);
+    if (strcmp(name, "scalar") == 0) {
+        g_key_match_block = key_match_block_scalar;
+        g_key_kernel_name = "scalar";
+        return 1;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        g_key_match_block = key_match_block_sse2;
+        g_key_kernel_name = "sse2";
+        return 1;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        g_key_match_block = key_match_block_avx2;
+        g_key_kernel_name = "avx2";
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+// first row in [begin, end) whose id or reg slot matches q, or -1 (a candidate when q->verify)
+int key_column_find(const KeySlot *ids, const KeySlot *regs, int begin, int end, const KeyQuery *q) {
+    pthread_once(&g_key_kernel_once, key_kernel_select);
+    int i = begin;
+    for (; i + KEY_BLOCK_ROWS <= end; i += KEY_BLOCK_ROWS) {
+        uint32_t mask = g_key_match_block(ids + i, regs + i, q);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    for (; i < end; ++i) {
+        if (key_slot_matches(&ids[i], q) || key_slot_matches(&regs[i], q)) return i;
+    }
+    return -1;
+}
+
+/* ---------- Owner name pool (interned strings) ---------- */
+
+void owner_pool_init(OwnerPool *pool) {
+    memset(pool, 0, sizeof(*pool));
+}
+
+void owner_pool_free(OwnerPool *pool) {
+    free(pool->bytes);
+    free(pool->offsets);
+    free(pool->slots);
+    owner_pool_init(pool);
+}
+
+// drop every name but keep the buffers (the store reloads often)
+void owner_pool_clear(OwnerPool *pool) {
+    pool->bytes_used = 0;
+    pool->count = 0;
+    if (pool->slots) memset(pool->slots, 0, sizeof(uint32_t) * pool->slot_cap);
+}
+
+static uint32_t owner_hash(const char *s, size_t len) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+const char *owner_str(const OwnerPool *pool, OwnerHandle h) {
+    return h < pool->count ? pool->bytes + pool->offsets[h] : "";
+}
+
+// slot holding s, or the empty slot where it would go
+static uint32_t owner_probe(const OwnerPool *pool, const char *s, size_t len) {
+    uint32_t mask = pool->slot_cap - 1;
+    uint32_t i = owner_hash(s, len) & mask;
+    while (pool->slots[i]) {
+        const char *cur = pool->bytes + pool->offsets[pool->slots[i] - 1];
+        if (memcmp(cur, s, len) == 0 && cur[len] == '\0') break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int owner_pool_rehash(OwnerPool *pool, uint32_t slot_cap) {
+    uint32_t *slots = calloc(slot_cap, sizeof(uint32_t));
+    if (!slots) return 0;
+    free(pool->slots);
+    pool->slots = slots;
+    pool->slot_cap = slot_cap;
+    for (uint32_t h = 0; h < pool->count; ++h) {
+        const char *s = pool->bytes + pool->offsets[h];
+        pool->slots[owner_probe(pool, s, strlen(s))] = h + 1;
+    }
+    return 1;
+}
+
+// handle of s if it was interned, else OWNER_HANDLE_NONE (never inserts)
+OwnerHandle owner_lookup(const OwnerPool *pool, const char *s) {
+    if (pool->count == 0) return OWNER_HANDLE_NONE;
+    uint32_t slot = pool->slots[owner_probe(pool, s, strlen(s))];
+    return slot ? slot - 1 : OWNER_HANDLE_NONE;
+}
+
+// handle of s, adding it on first sight; OWNER_HANDLE_NONE when out of memory
+OwnerHandle owner_intern(OwnerPool *pool, const char *s) {
+    size_t len = strlen(s);
+    // keep the table at most half full
+    if ((pool->count + 1) * 2 > pool->slot_cap &&
+        !owner_pool_rehash(pool, pool->slot_cap ? pool->slot_cap * 2 : OWNER_POOL_INITIAL_SLOTS)) {
+        return OWNER_HANDLE_NONE;
+    }
+    uint32_t slot = owner_probe(pool, s, len);
+    if (pool->slots[slot]) return pool->slots[slot] - 1;
+
+    if (pool->count == pool->offsets_cap) {
+        uint32_t cap = pool->offsets_cap ? pool->offsets_cap * 2 : OWNER_POOL_INITIAL_SLOTS / 2;
+        uint32_t *p = realloc(pool->offsets, sizeof(uint32_t) * cap);
+        if (!p) return OWNER_HANDLE_NONE;
+        pool->offsets = p;
+        pool->offsets_cap = cap;
+    }
+    if (pool->bytes_used + len + 1 > pool->bytes_cap) {
+        size_t cap = pool->bytes_cap ? pool->bytes_cap : OWNER_POOL_INITIAL_BYTES;
+        while (cap < pool->bytes_used + len + 1) cap *= 2;
+        char *p = realloc(pool->bytes, cap);
+        if (!p) return OWNER_HANDLE_NONE;
+        pool->bytes = p;
+        pool->bytes_cap = cap;
+    }
+    OwnerHandle h = pool->count++;
+    pool->offsets[h] = (uint32_t)pool->bytes_used;
+    memcpy(pool->bytes + pool->bytes_used, s, len + 1);
+    pool->bytes_used += len + 1;
+    pool->slots[slot] = h + 1;
+    return h;
+}
+
+// heap bytes held by the pool
+size_t owner_pool_bytes(const OwnerPool *pool) {
+    return pool->bytes_cap + sizeof(uint32_t) * ((size_t)pool->offsets_cap + pool->slot_cap);
+}
+
+/* ---------- Key filter (blocked Bloom filter over both key columns) ---------- */
+
+static KeyFilterConfig g_key_filter = {.enabled = 1, .bits_per_key = KEY_FILTER_DEFAULT_BITS};
+
+KeyFilterConfig *key_filter_config(void) {
+    return &g_key_filter;
+}
+
+// the folded key packed into 8 bytes when it fits (equal words mean equal keys), else a
+// hash with the top bit set whose hits are only candidates
+uint64_t disk_key(const char *s) {
+    KeySlot k;
+    key_slot_set(&k, s);
+    if (!key_slot_is_overflow(&k)) {
+        uint64_t w = 0; // big-endian, so keys sort like the strings and new IDs land in the last leaf
+        for (int i = 0; i < KEY_SLOT_LEN; ++i) w = w << 8 | k.b[i];
+        return w;
+    }
+    uint64_t h = CSV_HASH_SEED;
+    for (; *s; ++s) {
+        h ^= fold_upper((unsigned char)*s);
+        h *= CSV_HASH_PRIME;
+    }
+    return h | DISK_KEY_HASHED;
+}
+
+// filter hash of a disk_key (splitmix64 finalizer): the high half picks the block,
+// the low bits the positions inside it
+uint64_t key_filter_hash(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+static uint32_t key_filter_block(uint64_t h, uint32_t nblocks) {
+    return (uint32_t)(((h >> 32) * nblocks) >> 32);
+}
+
+// next bit position inside a block: the top 9 bits of an LCG step seeded with the hash.
+// (a + i*b double hashing has only 512 * 256 patterns per block, which puts a floor of a
+// few hundredths of a percent under the false-positive rate however many bits are spent)
+static uint32_t key_filter_next_bit(uint64_t *x) {
+    *x = *x * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(*x >> 55);
+}
+
+// set (or test) hashes bits in one block. The words are read and written as relaxed
+// atomics: a snapshot's filter gains keys in place while readers of older snapshots probe
+// it. There is only ever one writer, so a load and a store will do
+static void key_filter_block_set(uint64_t *block, uint64_t h, int hashes) {
+    for (int i = 0; i < hashes; ++i) {
+        uint32_t a = key_filter_next_bit(&h);
+        uint64_t w = __atomic_load_n(&block[a / 64], __ATOMIC_RELAXED);
+        __atomic_store_n(&block[a / 64], w | 1ULL << (a % 64), __ATOMIC_RELAXED);
+    }
+}
+
+static int key_filter_block_test(const uint64_t *block, uint64_t h, int hashes) {
+    for (int i = 0; i < hashes; ++i) {
+        uint32_t a = key_filter_next_bit(&h);
+        if (!(__atomic_load_n(&block[a / 64], __ATOMIC_RELAXED) & (1ULL << (a % 64)))) return 0;
+    }
+    return 1;
+}
+
+// blocks and bits per key for capacity keys; hashes = bits_per_key * ln 2
+void key_filter_shape(uint64_t capacity, int bits_per_key, uint32_t *nblocks, int *hashes) {
+    uint64_t bits = capacity * (uint64_t)bits_per_key;
+    uint64_t blocks = (bits + KEY_FILTER_BLOCK_BITS - 1) / KEY_FILTER_BLOCK_BITS;
+    *nblocks = blocks ? (blocks < UINT32_MAX ? (uint32_t)blocks : UINT32_MAX) : 1;
+    *hashes = (bits_per_key * 693 + 500) / 1000;
+    if (*hashes < 1) *hashes = 1;
+    if (*hashes > KEY_FILTER_MAX_HASHES) *hashes = KEY_FILTER_MAX_HASHES;
+}
+
+// false-positive rate of a plain Bloom filter at bits_per_key (blocking adds a little)
+double key_filter_target_fp(int bits_per_key) {
+    double p = 1.0;
+    for (int i = 0; i < bits_per_key; ++i) p *= KEY_FILTER_FP_PER_BIT;
+    return p;
+}
+
+// fewest bits per key whose target rate is at most fp
+int key_filter_bits_for(double fp) {
+    int bits = 1;
+    while (bits < KEY_FILTER_MAX_BITS && key_filter_target_fp(bits) > fp) bits++;
+    return bits;
+}
+
+void key_filter_init(KeyFilter *f) {
+    memset(f, 0, sizeof(*f));
+}
+
+void key_filter_free(KeyFilter *f) {
+    free(f->blocks);
+    key_filter_init(f);
+}
+
+// empty filter for capacity keys; 0 when out of memory (the filter is then left off)
+int key_filter_reset(KeyFilter *f, uint64_t capacity, int bits_per_key) {
+    uint32_t nblocks;
+    int hashes;
+    key_filter_shape(capacity, bits_per_key, &nblocks, &hashes);
+    uint64_t *blocks = calloc((size_t)nblocks * KEY_FILTER_BLOCK_WORDS, sizeof(uint64_t));
+    free(f->blocks);
+    key_filter_init(f);
+    if (!blocks) return 0;
+    f->blocks = blocks;
+    f->nblocks = nblocks;
+    f->hashes = hashes;
+    f->capacity = capacity;
+    f->valid = 1;
+    return 1;
+}
+
+// add a key by its disk_key
+void key_filter_insert(KeyFilter *f, uint64_t dkey) {
+    uint64_t h = key_filter_hash(dkey);
+    key_filter_block_set(f->blocks + (size_t)key_filter_block(h, f->nblocks) * KEY_FILTER_BLOCK_WORDS, h, f->hashes);
+    f->keys++;
+}
+
+void key_filter_add(KeyFilter *f, const char *key) {
+    key_filter_insert(f, disk_key(key));
+}
+
+// 0 only if key was never added (case-insensitive); 1 for "maybe" and for a filter that is off
+int key_filter_may_contain(const KeyFilter *f, const char *key) {
+    if (!f->valid) return 1;
+    uint64_t h = key_filter_hash(disk_key(key));
+    return key_filter_block_test(f->blocks + (size_t)key_filter_block(h, f->nblocks) * KEY_FILTER_BLOCK_WORDS, h, f->hashes);
+}
+
+size_t key_filter_bytes(const KeyFilter *f) {
+    return f->valid ? (size_t)f->nblocks * KEY_FILTER_BLOCK_WORDS * sizeof(uint64_t) : 0;
+}
+
+// expected false-positive rate at the current fill: the mean over blocks of (share of the
+// block's bits set) ^ hashes, since a probe only ever looks at one block
+double key_filter_estimated_fp(const KeyFilter *f) {
+    if (!f->valid) return 1.0;
+    double sum = 0;
+    for (uint32_t b = 0; b < f->nblocks; ++b) {
+        int set = 0;
+        for (int i = 0; i < KEY_FILTER_BLOCK_WORDS; ++i) {
+            for (uint64_t w = f->blocks[(size_t)b * KEY_FILTER_BLOCK_WORDS + i]; w; w &= w - 1) set++;
+        }
+        double fill = (double)set / KEY_FILTER_BLOCK_BITS, p = 1.0;
+        for (int i = 0; i < f->hashes; ++i) p *= fill;
+        sum += p;
+    }
+    return sum / f->nblocks;
+}
+
+/* ---------- Search result cache (LRU, invalidated per key) ---------- */
+
+// entries per cache, applied to caches (re)built from now on
+static int g_search_cache_entries = SEARCH_CACHE_DEFAULT_ENTRIES;
+
+int search_cache_entries(void) {
+    return g_search_cache_entries;
+}
+
+// 0 turns caching off; existing caches pick the setting up once reset
+void search_cache_set_entries(int entries) {
+    g_search_cache_entries = entries < 0 ? 0 : entries > SEARCH_CACHE_MAX_ENTRIES ? SEARCH_CACHE_MAX_ENTRIES : entries;
+}
+
+void search_cache_init(SearchCache *c) {
+    memset(c, 0, sizeof(*c));
+    c->head = c->tail = c->free_list = -1;
+}
+
+// drop the entries; the next search sets the cache up with the current capacity setting.
+// The counters are kept
+void search_cache_reset(SearchCache *c) {
+    for (int i = 0; c->entries && i < c->capacity; ++i) free(c->entries[i].text);
+    free(c->entries);
+    free(c->buckets);
+    c->entries = NULL;
+    c->buckets = NULL;
+    c->capacity = c->nbuckets = c->count = 0;
+    c->head = c->tail = c->free_list = -1;
+    c->bytes = 0;
+}
+
+void search_cache_free(SearchCache *c) {
+    search_cache_reset(c);
+    search_cache_init(c);
+}
+
+static void search_cache_fold(const char *key, char *out) {
+    size_t i = 0;
+    for (; key[i] && i < ID_REG_MAX_LEN; ++i) out[i] = (char)fold_upper((unsigned char)key[i]);
+    out[i] = '\0';
+}
+
+static uint32_t search_cache_bucket(const SearchCache *c, const char *folded) {
+    return owner_hash(folded, strlen(folded)) & (uint32_t)(c->nbuckets - 1);
+}
+
+static int search_cache_setup(SearchCache *c) {
+    int cap = g_search_cache_entries;
+    int nb = 1;
+    while (nb < 2 * cap) nb <<= 1;
+    c->entries = calloc((size_t)cap, sizeof(SearchCacheEntry));
+    c->buckets = malloc(sizeof(int) * (size_t)nb);
+    if (!c->entries || !c->buckets) {
+        search_cache_reset(c);
+        return 0;
+    }
+    for (int b = 0; b < nb; ++b) c->buckets[b] = -1;
+    for (int i = 0; i < cap; ++i) c->entries[i].next = i + 1 < cap ? i + 1 : -1;
+    c->capacity = cap;
+    c->nbuckets = nb;
+    c->free_list = 0;
+    return 1;
+}
+
+static void search_cache_unlink(SearchCache *c, int i) {
+    SearchCacheEntry *e = &c->entries[i];
+    if (e->prev >= 0) c->entries[e->prev].next = e->next;
+    else c->head = e->next;
+    if (e->next >= 0) c->entries[e->next].prev = e->prev;
+    else c->tail = e->prev;
+}
+
+static void search_cache_push_front(SearchCache *c, int i) {
+    SearchCacheEntry *e = &c->entries[i];
+    e->prev = -1;
+    e->next = c->head;
+    if (c->head >= 0) c->entries[c->head].prev = i;
+    c->head = i;
+    if (c->tail < 0) c->tail = i;
+}
+
+// take entry i out of its chain and the LRU list, back onto the free list
+static void search_cache_drop(SearchCache *c, int i) {
+    SearchCacheEntry *e = &c->entries[i];
+    int *link = &c->buckets[search_cache_bucket(c, e->key)];
+    while (*link != i) link = &c->entries[*link].hnext;
+    *link = e->hnext;
+    search_cache_unlink(c, i);
+    c->bytes -= e->len;
+    free(e->text);
+    e->text = NULL;
+    e->len = 0;
+    e->next = c->free_list;
+    c->free_list = i;
+    c->count--;
+}
+
+// the cached result of searching key in sort order sort_field, or NULL (counted as a miss)
+const SearchCacheEntry *search_cache_get(SearchCache *c, const char *key, int sort_field) {
+    char folded[ID_REG_BUFFER_LEN];
+    if (g_search_cache_entries == 0) return NULL;
+    if (strlen(key) > ID_REG_MAX_LEN || c->count == 0) {
+        c->misses++;
+        return NULL;
+    }
+    search_cache_fold(key, folded);
+    for (int i = c->buckets[search_cache_bucket(c, folded)]; i >= 0; i = c->entries[i].hnext) {
+        SearchCacheEntry *e = &c->entries[i];
+        if (e->sort_field != sort_field || strcmp(e->key, folded) != 0) continue;
+        if (c->head != i) {
+            search_cache_unlink(c, i);
+            search_cache_push_front(c, i);
+        }
+        c->hits++;
+        return e;
+    }
+    c->misses++;
+    return NULL;
+}
+
+// keep a search's result; results bigger than SEARCH_CACHE_MAX_ENTRY_BYTES are not kept.
+// Returns 0 when it was not stored (too big, cache off, out of memory)
+int search_cache_put(SearchCache *c, const char *key, int sort_field, int rows, const char *text, size_t len) {
+    if (g_search_cache_entries == 0 || strlen(key) > ID_REG_MAX_LEN || len > SEARCH_CACHE_MAX_ENTRY_BYTES) return 0;
+    if (!c->entries && !search_cache_setup(c)) return 0;
+    char *copy = malloc(len ? len : 1);
+    if (!copy) return 0;
+    memcpy(copy, text, len);
+    if (c->free_list < 0) {
+        search_cache_drop(c, c->tail);
+        c->evictions++;
+    }
+    int i = c->free_list;
+    SearchCacheEntry *e = &c->entries[i];
+    c->free_list = e->next;
+    search_cache_fold(key, e->key);
+    e->sort_field = sort_field;
+    e->rows = rows;
+    e->text = copy;
+    e->len = len;
+    int *head = &c->buckets[search_cache_bucket(c, e->key)];
+    e->hnext = *head;
+    *head = i;
+    search_cache_push_front(c, i);
+    c->bytes += len;
+    c->count++;
+    return 1;
+}
+
+// a row whose InspectionID or CarRegNumber is key changed: every cached search for key goes
+void search_cache_invalidate(SearchCache *c, const char *key) {
+    if (c->count == 0 || strlen(key) > ID_REG_MAX_LEN) return;
+    char folded[ID_REG_BUFFER_LEN];
+    search_cache_fold(key, folded);
+    int i = c->buckets[search_cache_bucket(c, folded)];
+    while (i >= 0) {
+        int next = c->entries[i].hnext;
+        if (strcmp(c->entries[i].key, folded) == 0) {
+            search_cache_drop(c, i);
+            c->invalidations++;
+        }
+        i = next;
+    }
+}
+
+// every row may have changed (a full reload)
+void search_cache_flush(SearchCache *c) {
+    if (c->count == 0) return;
+    while (c->head >= 0) search_cache_drop(c, c->head);
+    c->flushes++;
+}
+
+// heap bytes held: the entry table, the chains and the cached text
+size_t search_cache_bytes(const SearchCache *c) {
+    return sizeof(SearchCacheEntry) * (size_t)c->capacity + sizeof(int) * (size_t)c->nbuckets + c->bytes;
+}
+
+/* ---------- Record store (heap-backed, no MAX_RECORDS cap) ---------- */
+
+void store_init(RecordStore *store) {
+    store->rows = NULL;
+    store->id_keys = NULL;
+    store->reg_keys = NULL;
+    store->day_keys = NULL;
+    owner_pool_init(&store->owners);
+    store->count = 0;
+    store->capacity = 0;
+    store->version = 1;
+    memset(store->views, 0, sizeof(store->views));
+    store->sort_scratch = NULL;
+    store->sort_scratch_cap = 0;
+    memset(&store->plate_index, 0, sizeof(store->plate_index));
+    memset(&store->csv, 0, sizeof(store->csv));
+    store->csv.watch_fd = CSV_WATCH_UNSET;
+    key_filter_init(&store->filter);
+    search_cache_init(&store->cache);
+}
+
+void store_free(RecordStore *store) {
+    free(store->rows);
+    free(store->id_keys);
+    free(store->reg_keys);
+    free(store->day_keys);
+    owner_pool_free(&store->owners);
+    for (int f = 0; f < SORT_FIELD_COUNT; ++f) {
+        free(store->views[f].perm);
+        free(store->views[f].rank);
+    }
+    free(store->sort_scratch);
+    free(store->plate_index.rows);
+    free(store->plate_index.groups);
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (store->csv.watch_fd >= 0) close(store->csv.watch_fd);
+#endif
+    key_filter_free(&store->filter);
+    search_cache_reset(&store->cache);
+    store_init(store);
+}
+
+// row idx as a full Record (owner name copied out of the pool)
+void store_get(const RecordStore *store, int idx, Record *out) {
+    const StoredRow *s = &store->rows[idx];
+    memcpy(out->inspectionID, s->inspectionID, sizeof(out->inspectionID));
+    memcpy(out->carReg, s->carReg, sizeof(out->carReg));
+    memcpy(out->date, s->date, sizeof(out->date));
+    strncpy(out->owner, owner_str(&store->owners, s->owner), sizeof(out->owner) - 1);
+    out->owner[sizeof(out->owner) - 1] = '\0';
+}
+
+const char *store_owner(const RecordStore *store, int idx) {
+    return owner_str(&store->owners, store->rows[idx].owner);
+}
+
+int store_reserve(RecordStore *store, int capacity) {
+    if (capacity <= store->capacity) return 1;
+    int newcap = store->capacity ? store->capacity : STORE_INITIAL_CAPACITY;
+    while (newcap < capacity) newcap *= 2;
+    StoredRow *p = realloc(store->rows, sizeof(StoredRow) * newcap);
+    if (!p) return 0;
+    store->rows = p;
+    KeySlot *ids = realloc(store->id_keys, sizeof(KeySlot) * newcap);
+    if (!ids) return 0;
+    store->id_keys = ids;
+    KeySlot *regs = realloc(store->reg_keys, sizeof(KeySlot) * newcap);
+    if (!regs) return 0;
+    store->reg_keys = regs;
+    uint32_t *days = realloc(store->day_keys, sizeof(uint32_t) * newcap);
+    if (!days) return 0;
+    store->day_keys = days;
+    store->capacity = newcap;
+    return 1;
+}
+
+static void store_refresh_keys(RecordStore *store, int idx) {
+    key_slot_set(&store->id_keys[idx], store->rows[idx].inspectionID);
+    key_slot_set(&store->reg_keys[idx], store->rows[idx].carReg);
+    store->day_keys[idx] = date_day_number(store->rows[idx].date);
+}
+
+static int store_pack(RecordStore *store, int idx, const Record *r) {
+    OwnerHandle h = owner_intern(&store->owners, r->owner);
+    if (h == OWNER_HANDLE_NONE) return 0;
+    StoredRow *s = &store->rows[idx];
+    if (idx < store->count) {
+        search_cache_invalidate(&store->cache, s->inspectionID);
+        search_cache_invalidate(&store->cache, s->carReg);
+    }
+    search_cache_invalidate(&store->cache, r->inspectionID);
+    search_cache_invalidate(&store->cache, r->carReg);
+    memcpy(s->inspectionID, r->inspectionID, sizeof(s->inspectionID));
+    memcpy(s->carReg, r->carReg, sizeof(s->carReg));
+    memcpy(s->date, r->date, sizeof(s->date));
+    s->owner = h;
+    store_refresh_keys(store, idx);
+    store->version++;
+    return 1;
+}
+
+// (re)build the key filter from every row, with headroom for adds; left off (every probe
+// "maybe") when it is disabled or out of memory
+int store_build_filter(RecordStore *store) {
+    KeyFilterConfig *c = key_filter_config();
+    uint64_t keys = 2 * (uint64_t)store->count;
+    uint64_t capacity = keys + keys / KEY_FILTER_HEADROOM + KEY_FILTER_MIN_KEYS;
+    if (!c->enabled || !key_filter_reset(&store->filter, capacity, c->bits_per_key)) {
+        key_filter_free(&store->filter);
+        return 0;
+    }
+    for (int i = 0; i < store->count; ++i) {
+        key_filter_add(&store->filter, store->rows[i].inspectionID);
+        key_filter_add(&store->filter, store->rows[i].carReg);
+    }
+    atomic_fetch_add(&c->rebuilds, 1);
+    return 1;
+}
+
+// row idx (already stored) got new keys; a filter past its capacity is rebuilt bigger
+static void store_filter_add(RecordStore *store, int idx) {
+    KeyFilter *f = &store->filter;
+    if (!f->valid) return;
+    if (f->keys + 2 > f->capacity) {
+        store_build_filter(store);
+        return;
+    }
+    key_filter_add(f, store->rows[idx].inspectionID);
+    key_filter_add(f, store->rows[idx].carReg);
+}
+
+int store_append(RecordStore *store, const Record *r) {
+    if (!store_reserve(store, store->count + 1)) return 0;
+    if (!store_pack(store, store->count, r)) return 0;
+    store->count++;
+    store_filter_add(store, store->count - 1);
+    return 1;
+}
+
+// overwrite row idx (update) and keep its key slots in step; 0 when out of memory
+int store_set(RecordStore *store, int idx, const Record *r) {
+    if (idx < 0 || idx >= store->count) return 0;
+    if (!store_pack(store, idx, r)) return 0;
+    store_filter_add(store, idx); // the old keys stay set: at worst a false positive
+    return 1;
+}
+
+// 0 if the filter (NULL or off: no filter) proves key is on no row, so the scan can be skipped
+static int key_filter_check(const KeyFilter *f, const char *key) {
+    if (!f || !f->valid) return 1;
+    KeyFilterConfig *c = key_filter_config();
+    atomic_fetch_add(&c->probes, 1);
+    if (key_filter_may_contain(f, key)) return 1;
+    atomic_fetch_add(&c->negatives, 1);
+    return 0;
+}
+
+// the filter said "maybe" and the scan found nothing
+static void key_filter_missed(const KeyFilter *f) {
+    if (f && f->valid) atomic_fetch_add(&key_filter_config()->false_positives, 1);
+}
+
+void store_remove(RecordStore *store, int idx) {
+    if (idx < 0 || idx >= store->count) return;
+    search_cache_invalidate(&store->cache, store->rows[idx].inspectionID);
+    search_cache_invalidate(&store->cache, store->rows[idx].carReg);
+    int tail = store->count - idx - 1;
+    memmove(&store->rows[idx], &store->rows[idx + 1], sizeof(StoredRow) * tail);
+    memmove(&store->id_keys[idx], &store->id_keys[idx + 1], sizeof(KeySlot) * tail);
+    memmove(&store->reg_keys[idx], &store->reg_keys[idx + 1], sizeof(KeySlot) * tail);
+    memmove(&store->day_keys[idx], &store->day_keys[idx + 1], sizeof(uint32_t) * tail);
+    store->count--;
+    store->version++;
+}
+
+// first row in [begin, end) matching q; candidates of long keys are confirmed with strcasecmp
+static int store_find_range(const RecordStore *store, int begin, int end, const KeyQuery *q) {
+    int i = begin;
+    while ((i = key_column_find(store->id_keys, store->reg_keys, i, end, q)) >= 0) {
+        if (!q->verify || strcasecmp(store->rows[i].inspectionID, q->key) == 0 ||
+            strcasecmp(store->rows[i].carReg, q->key) == 0) {
+            return i;
+        }
+        i++;
+    }
+    return -1;
+}
+
+typedef struct {
+    const RecordStore *store;
+    KeyQuery q;
+    atomic_int best;
+} StoreFindCtx;
+
+static void store_find_chunk(int begin, int end, void *ctx, void *out) {
+    (void)out;
+    StoreFindCtx *c = ctx;
+    if (begin >= atomic_load(&c->best)) return;
+    int i = store_find_range(c->store, begin, end, &c->q);
+    if (i < 0) return;
+    int cur = atomic_load(&c->best);
+    while (i < cur && !atomic_compare_exchange_weak(&c->best, &cur, i)) {}
+}
+
+// first row whose InspectionID or CarRegNumber equals key (case-insensitive), or -1
+int store_find_key(const RecordStore *store, const char *key) {
+    if (!key_filter_check(&store->filter, key)) return -1;
+    StoreFindCtx c;
+    key_query_init(&c.q, key);
+    int n = store->count, found;
+    if (n <= PARALLEL_SCAN_THRESHOLD) {
+        found = store_find_range(store, 0, n, &c.q);
+    } else {
+        c.store = store;
+        atomic_init(&c.best, n);
+        parallel_scan(scan_pool(), n, store_find_chunk, &c, NULL, 0);
+        found = atomic_load(&c.best) < n ? atomic_load(&c.best) : -1;
+    }
+    if (found < 0) key_filter_missed(&store->filter);
+    return found;
+}
+
+typedef struct {
+    const RecordStore *store;
+    KeyQuery q;
+} StoreCollectCtx;
+
+static void store_collect_chunk(int begin, int end, void *ctx, void *out) {
+    StoreCollectCtx *c = ctx;
+    IndexList *list = out;
+    int i = begin;
+    while ((i = store_find_range(c->store, i, end, &c->q)) >= 0) {
+        if (!index_list_push(list, i++)) return;
+    }
+}
+
+// every row matching key, in file order, into an array from arena; returns count or -1 (out of memory)
+int store_collect_key(const RecordStore *store, const char *key, Arena *arena, int **out_idx) {
+    *out_idx = NULL;
+    if (!key_filter_check(&store->filter, key)) return 0;
+    StoreCollectCtx c;
+    key_query_init(&c.q, key);
+    c.store = store;
+    ThreadPool *pool = store->count > PARALLEL_SCAN_THRESHOLD ? scan_pool() : NULL;
+    int chunks = scan_chunk_count(pool, store->count);
+    if (chunks == 0) return 0;
+    IndexList *lists = index_lists_alloc(arena, chunks);
+    if (!lists) return -1;
+    parallel_scan(pool, store->count, store_collect_chunk, &c, lists, sizeof(IndexList));
+    int n = merge_index_lists(lists, chunks, arena, out_idx);
+    if (n == 0) key_filter_missed(&store->filter);
+    return n;
+}
+
+static uint64_t csv_hash(uint64_t h, const char *p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        h ^= (unsigned char)p[i];
+        h *= CSV_HASH_PRIME;
+    }
+    return h;
+}
+
+int file_stamp(const char *path, FileStamp *out) {
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    out->size = (unsigned long long)st.st_size;
+    out->ino = (unsigned long long)st.st_ino;
+#if defined(__linux__)
+    out->mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#else
+    out->mtime_ns = (long long)st.st_mtime * 1000000000LL;
+#endif
+    return 1;
+}
+
+static const char *path_base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// watch the directory, not the file: saving through a rename replaces the inode
+static void csv_watch_start(CsvSync *s, const char *path) {
+    s->watch_fd = -1;
+#if defined(__linux__)
+    char dir[MAX_LINE];
+    const char *base = path_base_name(path);
+    if (base == path) strcpy(dir, ".");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(base - path), path);
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return;
+    if (inotify_add_watch(fd, dir, IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                                   IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+        close(fd);
+        return;
+    }
+    s->watch_fd = fd;
+#else
+    (void)path;
+#endif
+}
+
+// drain pending events; 1 if any of them may concern path (always 1 without a watch)
+static int csv_watch_changed(CsvSync *s, const char *path) {
+#if defined(__linux__)
+    if (s->watch_fd < 0) return 1;
+    const char *name = path_base_name(path);
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    ssize_t n;
+    while ((n = read(s->watch_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n;) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if ((ev->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF)) ||
+                (ev->len && strcmp(ev->name, name) == 0)) {
+                changed = 1;
+            }
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+    return changed;
+#else
+    (void)s;
+    (void)path;
+    return 1;
+#endif
+}
+
+// open path positioned just past the bytes already parsed, if they are unchanged; else NULL
+static FILE *csv_open_verified(const CsvSync *s, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    char buf[CSV_VERIFY_BLOCK];
+    uint64_t h = CSV_HASH_SEED;
+    unsigned long long left = s->offset;
+    while (left > 0) {
+        size_t want = left < sizeof(buf) ? (size_t)left : sizeof(buf);
+        size_t got = fread(buf, 1, want, f);
+        h = csv_hash(h, buf, got);
+        if (got != want) break;
+        left -= got;
+    }
+    if (left > 0 || h != s->hash) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+// parse f to the end, appending rows and extending offset/hash; 0 when out of memory
+static int csv_parse_from(RecordStore *store, FILE *f) {
+    CsvSync *s = &store->csv;
+    char line[MAX_LINE];
+    Record r;
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line);
+        s->hash = csv_hash(s->hash, line, len);
+        s->offset += len;
+        s->newline_end = len > 0 && line[len - 1] == '\n';
+        if (!strip_line_ending(line)) continue;
+        if (!parse_record_line(line, &r)) continue;
+        if (!store_append(store, &r)) {
+            s->error = ENOMEM;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void csv_mark_synced(RecordStore *store, const FileStamp *stamp) {
+    store->csv.stamp = *stamp;
+    store->csv.stamped_at = time(NULL);
+    store->csv.version = store->version;
+}
+
+// drop every row before a full reload; the key filter is rebuilt once, after the parse
+static void store_reset_rows(RecordStore *store) {
+    CsvSync *s = &store->csv;
+    store->count = 0;
+    store->version++;
+    owner_pool_clear(&store->owners);
+    key_filter_free(&store->filter);
+    search_cache_flush(&store->cache);
+    s->offset = 0;
+    s->hash = CSV_HASH_SEED;
+    s->newline_end = 1;
+    s->version = 0;
+}
+
+// bring the store in line with path; return row count. Only what changed is read:
+// nothing when the file is untouched, the appended tail when it only grew, and the
+// whole file when it was rewritten, truncated or replaced, or the store has unsaved edits.
+// A file that cannot be opened, or rows that do not fit in memory, leave csv.error set
+int store_load_path(RecordStore *store, const char *path) {
+    CsvSync *s = &store->csv;
+    s->error = 0;
+    if (s->watch_fd == CSV_WATCH_UNSET) csv_watch_start(s, path);
+    int event = csv_watch_changed(s, path);
+    int synced = s->version != 0 && s->version == store->version;
+    if (synced && (!event || s->detached)) {
+        s->skipped_loads++;
+        return store->count;
+    }
+
+    FileStamp now;
+    int have_stamp = file_stamp(path, &now);
+    if (synced && have_stamp && now.ino == s->stamp.ino && now.size >= s->offset) {
+        int same = now.size == s->stamp.size && now.mtime_ns == s->stamp.mtime_ns;
+        // mtime only moves once per clock tick, so a stamp taken within that window proves nothing
+        int racy = now.mtime_ns / 1000000000LL + CSV_RACY_SECONDS > (long long)s->stamped_at;
+        if (same && !racy) {
+            s->skipped_loads++;
+            return store->count;
+        }
+        FILE *f = (s->newline_end || now.size == s->offset) ? csv_open_verified(s, path) : NULL;
+        if (f) {
+            int grew = now.size > s->offset;
+            int ok = !grew || csv_parse_from(store, f);
+            fclose(f);
+            if (grew) s->tail_loads++;
+            else s->skipped_loads++;
+            if (ok) csv_mark_synced(store, &now);
+            else s->version = 0;
+            return store->count;
+        }
+    }
+
+    store_reset_rows(store);
+    s->full_loads++;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        s->error = errno;
+        return 0;
+    }
+    if (csv_parse_from(store, f) && have_stamp) csv_mark_synced(store, &now);
+    fclose(f);
+    store_build_filter(store);
+    return store->count;
+}
+
+/* ---------- Integrity sweep ---------- */
+
+// A load keeps whatever the file says: a row with fewer than 4 fields is skipped without
+// a word, and bad fields or a repeated InspectionID are loaded as they are. The sweep
+// reads the file in INTEGRITY_BLOCK_BYTES blocks. The scan pool checks each block's lines
+// with the fast validators, one line-aligned byte range per task; one pass in file order
+// then finds repeated InspectionIDs and the pool formats the offending lines for the
+// quarantine file. A valid InspectionID is a letter and 001..999, so the IDs seen so far
+// are a table of INTEGRITY_ID_SLOTS first lines rather than a hashed set.
+
+static const char *const g_integrity_names[INTEGRITY_KINDS] = {
+    "short row", "extra fields", "long line", "bad InspectionID",
+    "bad CarRegNumber", "bad OwnerName", "bad InspectionDate", "duplicate InspectionID",
+};
+
+void integrity_quarantine_path(const char *csv_path, char *out, size_t cap) {
+    size_t len = strlen(csv_path);
+    if (len >= 4 && strcasecmp(csv_path + len - 4, ".csv") == 0) len -= 4;
+    snprintf(out, cap, "%.*s%s", (int)len, csv_path, INTEGRITY_QUARANTINE_EXT);
+}
+
+typedef struct {
+    uint32_t line; // counted from the first line of its byte range
+    uint32_t off; // in the block
+    uint32_t len; // without the line ending
+    int id_slot; // of a valid InspectionID, -1 otherwise
+    unsigned problems;
+    long first; // line of the earlier row with the same InspectionID
+} IntegrityRow;
+
+// one byte range of a block: its non-blank lines, then the quarantine lines for them
+typedef struct {
+    const char *buf;
+    long first_line; // file line number of the range's first line
+    uint32_t lines; // lines started in the range, blank ones included
+    IntegrityRow *rows;
+    int nrows, cap;
+    char *out;
+    size_t out_len, out_cap;
+    int oom;
+} IntegrityPart;
+
+typedef struct {
+    const char *buf;
+    int len; // ends with a whole line
+} IntegrityBlock;
+
+// the fields parse_record_line would read from s (empty ones are skipped); returns how many there are
+static int integrity_split(const char *s, size_t len, Record *r) {
+    char *dst[4] = {r->inspectionID, r->carReg, r->owner, r->date};
+    size_t cap[4] = {sizeof(r->inspectionID), sizeof(r->carReg), sizeof(r->owner), sizeof(r->date)};
+    int n = 0;
+    size_t i = 0;
+    while (i < len) {
+        while (i < len && s[i] == ',') i++;
+        if (i == len) break;
+        size_t start = i;
+        while (i < len && s[i] != ',') i++;
+        if (n < 4) {
+            size_t k = i - start < cap[n] - 1 ? i - start : cap[n] - 1;
+            memcpy(dst[n], s + start, k);
+            dst[n][k] = '\0';
+            trim_whitespace(dst[n]);
+        }
+        n++;
+    }
+    return n;
+}
+
+// the problems a load would hit on one line (line ending removed); *id_slot is set for a valid InspectionID
+static unsigned integrity_check_line(const char *s, size_t len, int *id_slot) {
+    *id_slot = -1;
+    // fgets hands a load MAX_LINE - 1 bytes at a time, so the rest comes back as another row
+    if (len > MAX_LINE - 1) return INTEGRITY_LONG_LINE;
+    Record r;
+    int fields = integrity_split(s, len, &r);
+    if (fields < 4) return INTEGRITY_SHORT_ROW;
+    unsigned problems = fields > 4 ? INTEGRITY_EXTRA_FIELDS : 0;
+    char normalized[DATE_BUFFER_LEN];
+    if (!is_valid_id_fast(r.inspectionID)) problems |= INTEGRITY_BAD_ID;
+    else *id_slot = (r.inspectionID[0] - 'A') * 999 + atoi(r.inspectionID + 1) - 1;
+    if (!is_valid_car_reg_fast(r.carReg)) problems |= INTEGRITY_BAD_CAR_REG;
+    if (!is_valid_owner_name_fast(r.owner)) problems |= INTEGRITY_BAD_OWNER;
+    if (!is_valid_date_fast(r.date, normalized)) problems |= INTEGRITY_BAD_DATE;
+    return problems;
+}
+
+// check the lines that start in [begin, end) of the block
+static void integrity_check_range(int begin, int end, void *ctx, void *out) {
+    const IntegrityBlock *b = ctx;
+    IntegrityPart *part = out;
+    part->buf = b->buf;
+    part->lines = 0;
+    part->nrows = 0;
+    part->out_len = 0;
+    part->oom = 0;
+    int p = begin;
+    if (p > 0 && b->buf[p - 1] != '\n') {
+        const char *nl = memchr(b->buf + p, '\n', (size_t)(b->len - p));
+        p = nl ? (int)(nl - b->buf) + 1 : b->len;
+    }
+    while (p < end) {
+        const char *s = b->buf + p;
+        const char *nl = memchr(s, '\n', (size_t)(b->len - p));
+        int e = nl ? (int)(nl - b->buf) : b->len;
+        // the load cuts a line at its first '\r' and skips it when nothing is left
+        const char *cr = memchr(s, '\r', (size_t)(e - p));
+        size_t len = cr ? (size_t)(cr - s) : (size_t)(e - p);
+        if (len > 0) {
+            if (part->nrows == part->cap) {
+                int cap = part->cap ? part->cap * 2 : 1024;
+                IntegrityRow *rows = realloc(part->rows, sizeof(IntegrityRow) * (size_t)cap);
+                if (!rows) {
+                    part->oom = 1;
+                    return;
+                }
+                part->rows = rows;
+                part->cap = cap;
+            }
+            IntegrityRow *row = &part->rows[part->nrows++];
+            row->line = part->lines;
+            row->off = (uint32_t)p;
+            row->len = (uint32_t)(e - p);
+            if (row->len > 0 && s[row->len - 1] == '\r') row->len--;
+            row->problems = integrity_check_line(s, len, &row->id_slot);
+            row->first = 0;
+        }
+        part->lines++;
+        p = e + 1;
+    }
+}
+
+// append `line,"problem; problem",raw line` for each offending row of the part
+static void integrity_format_task(void *arg) {
+    IntegrityPart *part = arg;
+    for (int i = 0; i < part->nrows && !part->oom; ++i) {
+        const IntegrityRow *row = &part->rows[i];
+        if (!row->problems) continue;
+        size_t need = part->out_len + 2 * (size_t)row->len + 512;
+        if (need > part->out_cap) {
+            size_t cap = part->out_cap ? part->out_cap : 64 * 1024;
+            while (cap < need) cap *= 2;
+            char *grown = realloc(part->out, cap);
+            if (!grown) {
+                part->oom = 1;
+                return;
+            }
+            part->out = grown;
+            part->out_cap = cap;
+        }
+        char *o = part->out + part->out_len;
+        o += sprintf(o, "%ld,\"", part->first_line + (long)row->line);
+        const char *sep = "";
+        for (int k = 0; k < INTEGRITY_KINDS; ++k) {
+            if (!(row->problems & (1u << k))) continue;
+            o += sprintf(o, "%s%s", sep, g_integrity_names[k]);
+            if ((1u << k) == INTEGRITY_DUPLICATE_ID) o += sprintf(o, " of line %ld", row->first);
+            sep = "; ";
+        }
+        *o++ = '"';
+        *o++ = ',';
+        *o++ = '"';
+        const char *s = part->buf + row->off;
+        for (uint32_t j = 0; j < row->len; ++j) {
+            if (s[j] == '"') *o++ = '"';
+            *o++ = s[j];
+        }
+        *o++ = '"';
+        *o++ = '\n';
+        part->out_len = (size_t)(o - part->out);
+    }
+}
+
+typedef struct {
+    IntegrityPart parts[SCAN_MAX_CHUNKS];
+    long *first_seen; // file line of each valid InspectionID's first row, 0 if none yet
+    FILE *q;
+    const char *q_path;
+    long line; // lines before the current block
+} IntegritySweep;
+
+// check one block, mark repeated IDs in file order and write its offending rows; 0 on failure
+static int integrity_block(IntegritySweep *w, ThreadPool *pool, const char *buf, int len, IntegrityReport *r) {
+    IntegrityBlock b = {buf, len};
+    int nparts = parallel_scan(pool, len, integrity_check_range, &b, w->parts, sizeof(IntegrityPart));
+    int bad = 0;
+    for (int i = 0; i < nparts; ++i) {
+        IntegrityPart *part = &w->parts[i];
+        if (part->oom) return 0;
+        part->first_line = w->line + 1;
+        w->line += part->lines;
+        r->lines += part->lines;
+        r->rows += part->nrows;
+        for (int j = 0; j < part->nrows; ++j) {
+            IntegrityRow *row = &part->rows[j];
+            if (row->id_slot >= 0) {
+                long *seen = &w->first_seen[row->id_slot];
+                if (*seen) {
+                    row->problems |= INTEGRITY_DUPLICATE_ID;
+                    row->first = *seen;
+                } else {
+                    *seen = part->first_line + (long)row->line;
+                }
+            }
+            if (!row->problems) continue;
+            bad++;
+            for (int k = 0; k < INTEGRITY_KINDS; ++k) r->problems[k] += (row->problems >> k) & 1u;
+        }
+    }
+    r->quarantined += bad;
+    if (!bad || !w->q_path) return 1;
+
+    if (pool && nparts > 1) {
+        TaskGroup group;
+        task_group_init(&group);
+        for (int i = 0; i < nparts; ++i) thread_pool_submit(pool, &group, integrity_format_task, &w->parts[i]);
+        task_group_wait(pool, &group);
+        task_group_destroy(&group);
+    } else {
+        for (int i = 0; i < nparts; ++i) integrity_format_task(&w->parts[i]);
+    }
+    if (!w->q) {
+        w->q = fopen(w->q_path, "w");
+        if (!w->q || fputs("line,problems,row\n", w->q) == EOF) return 0;
+    }
+    for (int i = 0; i < nparts; ++i) {
+        IntegrityPart *part = &w->parts[i];
+        if (part->oom || (part->out_len && fwrite(part->out, 1, part->out_len, w->q) != part->out_len)) return 0;
+    }
+    return 1;
+}
+
+// Check every line of csv_path the way a load would read it and, when quarantine_path
+// is given, write each offending row there with its line number and problems (the file
+// is removed when there are none). pool may be NULL. Returns the number of offending
+// rows, or -1 if the CSV cannot be read, memory runs out or the quarantine file cannot
+// be written.
+long integrity_sweep(const char *csv_path, const char *quarantine_path, ThreadPool *pool, IntegrityReport *out) {
+    IntegrityReport r;
+    memset(&r, 0, sizeof(r));
+    r.threads = scan_thread_count(pool);
+    double t0 = now_ms();
+    FILE *f = fopen(csv_path, "rb");
+    char *buf = malloc(INTEGRITY_BLOCK_BYTES);
+    IntegritySweep *w = calloc(1, sizeof(IntegritySweep));
+    long *seen = calloc(INTEGRITY_ID_SLOTS, sizeof(long));
+    int ok = f && buf && w && seen;
+    if (ok) {
+        w->first_seen = seen;
+        w->q_path = quarantine_path;
+    }
+    size_t have = 0;
+    int skip = 0; // the block starts inside a line already checked
+    while (ok) {
+        size_t got = fread(buf + have, 1, INTEGRITY_BLOCK_BYTES - have, f);
+        size_t len = have + got, cut = len, from = 0;
+        if (len == 0) break;
+        int last = have + got < INTEGRITY_BLOCK_BYTES;
+        if (skip) {
+            const char *nl = memchr(buf, '\n', len);
+            from = nl ? (size_t)(nl - buf) + 1 : len;
+            skip = !nl;
+        }
+        if (!last) {
+            while (cut > from && buf[cut - 1] != '\n') cut--;
+            // a line longer than a block: check what fits and skip the rest of it
+            if (cut == 0) {
+                cut = len;
+                skip = 1;
+            }
+        }
+        if (cut > from) ok = integrity_block(w, pool, buf + from, (int)(cut - from), &r);
+        have = len - cut;
+        memmove(buf, buf + cut, have);
+        if (last && !have) break;
+    }
+    if (ok && f && ferror(f)) ok = 0;
+    if (w && w->q && fclose(w->q) != 0) ok = 0;
+    if (ok && quarantine_path && r.quarantined == 0) remove(quarantine_path);
+    if (f) fclose(f);
+    for (int i = 0; w && i < SCAN_MAX_CHUNKS; ++i) {
+        free(w->parts[i].rows);
+        free(w->parts[i].out);
+    }
+    free(w);
+    free(seen);
+    free(buf);
+    r.ms = now_ms() - t0;
+    if (out) *out = r;
+    return ok ? r.quarantined : -1;
+}
+
+void print_integrity_report(const IntegrityReport *r, const char *csv_path, const char *quarantine_path, FILE *out) {
+    fprintf(out, "%s: %ld lines, %ld rows checked in %.1f ms (%d thread%s)\n", csv_path, r->lines, r->rows, r->ms,
+            r->threads, r->threads == 1 ? "" : "s");
+    if (!r->quarantined) {
+        fprintf(out, "No problems found.\n");
+        return;
+    }
+    for (int k = 0; k < INTEGRITY_KINDS; ++k) {
+        if (r->problems[k]) fprintf(out, "  %-24s %ld\n", g_integrity_names[k], r->problems[k]);
+    }
+    fprintf(out, "%ld row(s) quarantined", r->quarantined);
+    if (quarantine_path) fprintf(out, " in %s, with their line numbers", quarantine_path);
+    fprintf(out, ".\n");
+}
+
+// overwrite path with the store: rows go to path.tmp, which then replaces path, so a failed
+// write leaves the old file whole. sync is SAVE_NO_SYNC, SAVE_SYNC_DATA (the new file is on
+// disk before the rename, so after a crash one of the two files is there complete) or
+// SAVE_SYNC_ALL (the rename is on disk too). The sync state follows, so the next load skips
+// our own write. 0 when path cannot be written or synced (errno says why)
+int store_save_path(RecordStore *store, const char *path, int sync) {
+    char tmp[MAX_LINE + sizeof(".tmp")];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    CsvSync *s = &store->csv;
+    s->version = 0; // out of sync until the new file is in place
+    FILE *f = fopen(tmp, "w");
+    if (!f) return 0;
+    char line[MAX_LINE];
+    uint64_t hash = CSV_HASH_SEED;
+    unsigned long long offset = 0;
+    for (int i = 0; i < store->count; ++i) {
+        const StoredRow *r = &store->rows[i];
+        int len = snprintf(line, sizeof(line), "%s,%s,%s,%s\n", r->inspectionID, r->carReg, store_owner(store, i), r->date);
+        fputs(line, f);
+        hash = csv_hash(hash, line, (size_t)len);
+        offset += (unsigned long long)len;
+    }
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    if (ok && sync != SAVE_NO_SYNC) ok = file_sync(tmp);
+    if (ok) ok = file_replace(tmp, path);
+    if (!ok) {
+        int err = errno;
+        remove(tmp);
+        errno = err;
+        return 0;
+    }
+    s->offset = offset;
+    s->hash = hash;
+    s->newline_end = 1;
+    FileStamp now;
+    if (file_stamp(path, &now)) csv_mark_synced(store, &now);
+    return sync != SAVE_SYNC_ALL || dir_sync(path);
+}
+
+// the store's last row was just appended to path as line at offset at: extend the sync
+// state so the next load does not parse it again. Anything unexpected (other rows changed
+// too, another writer got in first) leaves the store out of sync and the next load reloads
+void store_note_append(RecordStore *store, const char *path, const char *line, size_t len, unsigned long long at) {
+    CsvSync *s = &store->csv;
+    // store_append bumps version exactly once
+    if (s->version == 0 || s->version + 1 != store->version || at != s->offset || !s->newline_end) return;
+    FileStamp now;
+    if (!file_stamp(path, &now) || now.size != s->offset + len) return;
+    s->hash = csv_hash(s->hash, line, len);
+    s->offset += len;
+    csv_mark_synced(store, &now);
+}
+
+// rows whose owner is exactly name: one hash lookup, then integer compares
+int store_count_owner(const RecordStore *store, const char *name) {
+    OwnerHandle h = owner_lookup(&store->owners, name);
+    if (h == OWNER_HANDLE_NONE) return 0;
+    int count = 0;
+    for (int i = 0; i < store->count; ++i) count += store->rows[i].owner == h;
+    return count;
+}
+
+/* ---------- Streaming key search (block reads, in-place compare) ---------- */
+
+static int record_list_push(Record **v, int *n, int *cap, const Record *r) {
+    if (*n == *cap) {
+        int newcap = *cap ? *cap * 2 : 16;
+        Record *p = realloc(*v, sizeof(Record) * (size_t)newcap);
+        if (!p) return 0;
+        *v = p;
+        *cap = newcap;
+    }
+    (*v)[(*n)++] = *r;
+    return 1;
+}
+
+int record_has_key(const Record *r, const char *key) {
+    return strcasecmp(r->inspectionID, key) == 0 || strcasecmp(r->carReg, key) == 0;
+}
+
+// whether p..e, less the whitespace trim_whitespace drops, is the lowercase key of klen bytes
+static int field_is_key(const char *p, const char *e, const char *folded, size_t klen) {
+    while (p < e && isspace((unsigned char)*p)) p++;
+    while (e > p && isspace((unsigned char)e[-1])) e--;
+    if ((size_t)(e - p) != klen) return 0;
+    for (size_t i = 0; i < klen; ++i) {
+        if (tolower((unsigned char)p[i]) != folded[i]) return 0;
+    }
+    return 1;
+}
+
+// 1 when the line s..e holds the key in its InspectionID field, 2 in its CarRegNumber
+// field, else 0. Fields are split the way parse_record_line does (empty ones skipped)
+static int csv_line_key_field(const char *s, const char *e, const char *folded, size_t klen) {
+    for (int field = 1; field <= 2; ++field) {
+        while (s < e && *s == ',') s++;
+        if (s == e) return 0;
+        const char *end = memchr(s, ',', (size_t)(e - s));
+        if (!end) end = e;
+        if (field_is_key(s, end, folded, klen)) return field;
+        s = end;
+    }
+    return 0;
+}
+
+// rows from f's current position whose InspectionID or CarRegNumber is key (case-insensitive),
+// each passed to emit in file order. The file is read CSV_SEARCH_BLOCK bytes at a time and
+// the first two fields are compared where they lie in the block; only a matching line is
+// copied out and parsed, so memory stays one block and one row whatever the file size.
+// Pass unique_stop only when the key is known to be on one row at most (the file may hold
+// repeated InspectionIDs as well as plates); the search then ends at the first match.
+// Returns the number of matches, -1 on a read error or out of memory
+long csv_stream_search(FILE *f, const char *key, int unique_stop, RecordFn emit, void *ctx, StreamSearchStats *st) {
+    StreamSearchStats local;
+    if (!st) st = &local;
+    memset(st, 0, sizeof(*st));
+    st->first_hit_ms = -1;
+    char folded[MAX_LINE], line[MAX_LINE];
+    size_t klen = strlen(key);
+    if (klen == 0 || klen >= sizeof(folded)) return 0;
+    for (size_t i = 0; i < klen; ++i) folded[i] = (char)tolower((unsigned char)key[i]);
+    char *buf = malloc(CSV_SEARCH_BLOCK);
+    if (!buf) return -1;
+
+    double t0 = now_ms();
+    size_t have = 0;
+    long hits = 0;
+    int eof = 0, stop = 0;
+    Record r;
+    while (!eof && !stop) {
+        size_t want = CSV_SEARCH_BLOCK - have, got = fread(buf + have, 1, want, f);
+        st->bytes_read += (long long)got;
+        have += got;
+        eof = got < want;
+        char *s = buf, *end = buf + have;
+        while (!stop && s < end) {
+            char *nl = memchr(s, '\n', (size_t)(end - s));
+            if (!nl) {
+                if (!eof && s > buf) break; // carry the partial line over to the next read
+                nl = end; // the last line, or one longer than a whole block
+            }
+            char *e = memchr(s, '\r', (size_t)(nl - s));
+            if (!e) e = nl;
+            st->lines++;
+            if (s < e && csv_line_key_field(s, e, folded, klen)) {
+                size_t len = (size_t)(e - s) < sizeof(line) - 1 ? (size_t)(e - s) : sizeof(line) - 1;
+                memcpy(line, s, len);
+                line[len] = '\0';
+                if (parse_record_line(line, &r) && record_has_key(&r, key)) {
+                    if (hits++ == 0) st->first_hit_ms = now_ms() - t0;
+                    if (emit) emit(&r, ctx);
+                    stop = unique_stop;
+                }
+            }
+            s = nl < end ? nl + 1 : end;
+        }
+        have = (size_t)(end - s);
+        memmove(buf, s, have);
+    }
+    st->stopped_early = stop;
+    int failed = ferror(f);
+    free(buf);
+    return failed ? -1 : hits;
+}
+
+typedef struct {
+    Record *v;
+    int n;
+    int cap;
+    int ok;
+} RecordList;
+
+static void record_list_emit(const Record *r, void *ctx) {
+    RecordList *l = ctx;
+    if (l->ok) l->ok = record_list_push(&l->v, &l->n, &l->cap, r);
+}
+
+/* ---------- On-disk B+tree index (one-shot lookups) ---------- */
+
+typedef struct {
+    IndexEntry *v;
+    size_t n;
+    size_t cap;
+} EntryList;
+
+// (first entry, page) of a node written by a rebuild, for the level above it
+typedef struct {
+    IndexEntry first;
+    uint32_t page;
+} NodeRef;
+
+static int index_entry_cmp(const IndexEntry *a, const IndexEntry *b) {
+    if (a->key != b->key) return a->key < b->key ? -1 : 1;
+    return (a->off > b->off) - (a->off < b->off);
+}
+
+// stable LSD radix sort on key, skipping constant bytes like radix_sort_u64; entries are
+// collected in file order, so ties stay sorted by offset
+static void radix_sort_entries(IndexEntry *v, IndexEntry *tmp, size_t n) {
+    if (n < 2) return;
+    size_t hist[8][256];
+    memset(hist, 0, sizeof(hist));
+    for (size_t i = 0; i < n; ++i) {
+        for (int b = 0; b < 8; ++b) hist[b][(v[i].key >> (8 * b)) & 0xFF]++;
+    }
+    IndexEntry *src = v, *dst = tmp;
+    for (int b = 0; b < 8; ++b) {
+        size_t *h = hist[b];
+        if (h[(src[0].key >> (8 * b)) & 0xFF] == n) continue;
+        size_t sum = 0;
+        for (int d = 0; d < 256; ++d) {
+            size_t c = h[d];
+            h[d] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; ++i) dst[h[(src[i].key >> (8 * b)) & 0xFF]++] = src[i];
+        IndexEntry *t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != v) memcpy(v, src, sizeof(IndexEntry) * n);
+}
+
+// a row's entries; an ID and plate with the same key share one
+static int entry_list_push_row(EntryList *l, const Record *r, uint64_t off) {
+    if (l->n + 2 > l->cap) {
+        size_t cap = l->cap ? l->cap * 2 : STORE_INITIAL_CAPACITY;
+        IndexEntry *v = realloc(l->v, sizeof(IndexEntry) * cap);
+        if (!v) return 0;
+        l->v = v;
+        l->cap = cap;
+    }
+    uint64_t id = disk_key(r->inspectionID), reg = disk_key(r->carReg);
+    l->v[l->n++] = (IndexEntry){id, off};
+    if (reg != id) l->v[l->n++] = (IndexEntry){reg, off};
+    return 1;
+}
+
+// collect entries for the complete lines of f from *pos on; *pos ends after the last '\n'
+static int index_scan_lines(FILE *f, uint64_t *pos, EntryList *l) {
+    char line[MAX_LINE];
+    Record r;
+    uint64_t off = *pos;
+    if (file_seek(f, off) != 0) return 0;
+    while (fgets(line, sizeof(line), f)) {
+        uint64_t start = off;
+        size_t len = strlen(line);
+        int whole = len > 0 && line[len - 1] == '\n';
+        int overlong = 0;
+        off += len;
+        while (!whole && len == sizeof(line) - 1 && fgets(line, sizeof(line), f)) {
+            overlong = 1; // no valid row is this long; skip to its end
+            len = strlen(line);
+            whole = len > 0 && line[len - 1] == '\n';
+            off += len;
+        }
+        if (!whole) break; // unfinished last line: indexed once it is complete
+        *pos = off;
+        if (overlong || !strip_line_ending(line) || !parse_record_line(line, &r)) continue;
+        if (!entry_list_push_row(l, &r, start)) return 0;
+    }
+    return !ferror(f);
+}
+
+// csv_hash of the bytes of f just before end (at most DISK_INDEX_TAIL_CHECK); 0 if f is shorter
+static int csv_tail_hash(FILE *f, uint64_t end, uint64_t *out) {
+    char buf[DISK_INDEX_TAIL_CHECK];
+    size_t n = end < sizeof(buf) ? (size_t)end : sizeof(buf);
+    if (file_seek(f, end - n) != 0 || fread(buf, 1, n, f) != n) return 0;
+    *out = csv_hash(CSV_HASH_SEED, buf, n);
+    return 1;
+}
+
+static int page_read(DiskIndex *ix, uint32_t page, DiskPage *out) {
+    ix->pages_read++;
+    return file_seek(ix->f, (unsigned long long)page * DISK_INDEX_PAGE) == 0 && fread(out, sizeof(*out), 1, ix->f) == 1;
+}
+
+static int page_write(FILE *f, uint32_t page, const DiskPage *p) {
+    return file_seek(f, (unsigned long long)page * DISK_INDEX_PAGE) == 0 && fwrite(p, sizeof(*p), 1, f) == 1;
+}
+
+static int meta_write(FILE *f, const IndexMeta *m) {
+    DiskPage page;
+    memset(&page, 0, sizeof(page));
+    memcpy(&page, m, sizeof(*m));
+    return page_write(f, 0, &page);
+}
+
+// children of an internal node whose separator is <= e: the child to descend into
+static uint32_t node_upper_bound(const DiskPage *page, const IndexEntry *e) {
+    uint32_t lo = 0, hi = page->count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (index_entry_cmp(&page->u.node.keys[mid], e) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// users_data.csv -> users_data.idx (other names get the extension appended)
+void disk_index_path(const char *csv_path, char *out, size_t cap) {
+    size_t len = strlen(csv_path);
+    if (len >= 4 && strcasecmp(csv_path + len - 4, ".csv") == 0) len -= 4;
+    snprintf(out, cap, "%.*s%s", (int)len, csv_path, CSV_INDEX_EXT);
+}
+
+// write csv_path's index from scratch: collect and sort every key, fill leaves left to
+// right to DISK_BUILD_FILL, then build each internal level over the one below. The file
+// is written beside the old index and renamed over it. Returns the entry count, or -1
+long disk_index_build(const char *csv_path) {
+    char idx_path[MAX_LINE], tmp_path[MAX_LINE + 4];
+    disk_index_path(csv_path, idx_path, sizeof(idx_path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", idx_path);
+    FILE *csv = fopen(csv_path, "rb");
+    if (!csv) return -1;
+    EntryList l = {NULL, 0, 0};
+    IndexMeta m;
+    memset(&m, 0, sizeof(m));
+    int ok = index_scan_lines(csv, &m.data_bytes, &l) && csv_tail_hash(csv, m.data_bytes, &m.tail_hash);
+    fclose(csv);
+
+    size_t per_leaf = DISK_LEAF_MAX * DISK_BUILD_FILL / 100;
+    size_t per_node = (DISK_INTERNAL_MAX + 1) * DISK_BUILD_FILL / 100;
+    size_t i;
+    IndexEntry *tmp = ok ? malloc(sizeof(IndexEntry) * (l.n + 1)) : NULL;
+    NodeRef *refs = tmp ? malloc(sizeof(NodeRef) * (l.n / per_leaf + 1)) : NULL;
+    FILE *f = refs ? fopen(tmp_path, "wb") : NULL;
+    if (!f) {
+        free(l.v);
+        free(tmp);
+        free(refs);
+        return -1;
+    }
+    radix_sort_entries(l.v, tmp, l.n);
+    memcpy(m.magic, DISK_INDEX_MAGIC, sizeof(m.magic));
+    m.page_size = DISK_INDEX_PAGE;
+    m.entries = l.n;
+    m.npages = 1;
+    m.height = 1;
+    m.clean = 1;
+
+    KeyFilter kf;
+    key_filter_init(&kf);
+    KeyFilterConfig *c = key_filter_config();
+    if (c->enabled && key_filter_reset(&kf, l.n + l.n / KEY_FILTER_HEADROOM + KEY_FILTER_MIN_KEYS, c->bits_per_key)) {
+        for (i = 0; i < l.n; ++i) key_filter_insert(&kf, l.v[i].key);
+        size_t bytes = (size_t)kf.nblocks * KEY_FILTER_BLOCK_WORDS * sizeof(uint64_t);
+        ok = ok && file_seek(f, DISK_INDEX_PAGE) == 0 && fwrite(kf.blocks, bytes, 1, f) == 1;
+        m.filter_blocks = kf.nblocks;
+        m.filter_hashes = (uint32_t)kf.hashes;
+        m.filter_capacity = kf.capacity;
+        m.filter_keys = l.n;
+        m.npages += (uint32_t)((bytes + DISK_INDEX_PAGE - 1) / DISK_INDEX_PAGE);
+    }
+    key_filter_free(&kf);
+
+    DiskPage page;
+    size_t nodes = 0;
+    i = 0;
+    do {
+        memset(&page, 0, sizeof(page));
+        page.type = DISK_PAGE_LEAF;
+        while (i < l.n && page.count < per_leaf) page.u.entries[page.count++] = l.v[i++];
+        page.next = i < l.n ? m.npages + 1 : 0;
+        refs[nodes].first = page.u.entries[0];
+        refs[nodes++].page = m.npages;
+        ok = ok && page_write(f, m.npages++, &page);
+    } while (i < l.n);
+
+    while (nodes > 1) {
+        size_t parents = 0;
+        for (size_t n = 0; n < nodes;) {
+            size_t take = nodes - n;
+            if (take > per_node) take = take < 2 * per_node ? (take + 1) / 2 : per_node; // no one-child tail node
+            memset(&page, 0, sizeof(page));
+            page.type = DISK_PAGE_INTERNAL;
+            page.u.node.child[0] = refs[n].page;
+            for (size_t k = 1; k < take; ++k) {
+                page.u.node.keys[page.count] = refs[n + k].first;
+                page.u.node.child[++page.count] = refs[n + k].page;
+            }
+            refs[parents].first = refs[n].first;
+            refs[parents++].page = m.npages;
+            ok = ok && page_write(f, m.npages++, &page);
+            n += take;
+        }
+        nodes = parents;
+        m.height++;
+    }
+    m.root = refs[0].page;
+    ok = ok && meta_write(f, &m);
+    if (fclose(f) != 0) ok = 0;
+    free(l.v);
+    free(tmp);
+    free(refs);
+    ok = ok && file_replace(tmp_path, idx_path);
+    if (!ok) remove(tmp_path);
+    return ok ? (long)m.entries : -1;
+}
+
+// open csv_path's index; 0 if there is none or it is not an index file
+int disk_index_open(DiskIndex *ix, const char *csv_path, int writable) {
+    char idx_path[MAX_LINE];
+    disk_index_path(csv_path, idx_path, sizeof(idx_path));
+    memset(ix, 0, sizeof(*ix));
+    ix->f = fopen(idx_path, writable ? "r+b" : "rb");
+    if (!ix->f) return 0;
+    DiskPage page;
+    int ok = page_read(ix, 0, &page);
+    memcpy(&ix->meta, &page, sizeof(ix->meta));
+    if (!ok || memcmp(ix->meta.magic, DISK_INDEX_MAGIC, sizeof(ix->meta.magic)) != 0 ||
+        ix->meta.page_size != DISK_INDEX_PAGE || ix->meta.height > DISK_INDEX_MAX_HEIGHT) {
+        fclose(ix->f);
+        ix->f = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+int disk_index_close(DiskIndex *ix) {
+    int ok = !ix->f || fclose(ix->f) == 0;
+    ix->f = NULL;
+    return ok;
+}
+
+// 1 if csv still holds the lines the index was built from. Only the bytes before
+// data_bytes are compared, which catches truncation and a rewritten end but not every
+// edit deep inside the file; lookups also check each row they read (disk_index_lookup)
+static int disk_index_matches(const DiskIndex *ix, FILE *csv) {
+    uint64_t h;
+    return ix->meta.clean && csv_tail_hash(csv, ix->meta.data_bytes, &h) && h == ix->meta.tail_hash;
+}
+
+// one key filter block of the index, read or written in place
+static int filter_block_io(DiskIndex *ix, uint32_t block, uint64_t *words, int write) {
+    size_t bytes = KEY_FILTER_BLOCK_WORDS * sizeof(uint64_t);
+    if (file_seek(ix->f, DISK_INDEX_PAGE + (unsigned long long)block * bytes) != 0) return 0;
+    if (write) return fwrite(words, bytes, 1, ix->f) == 1;
+    ix->pages_read++;
+    return fread(words, bytes, 1, ix->f) == 1;
+}
+
+// 0 if the index's key filter rules out key (a disk_key); 1 for "maybe" or no filter
+static int disk_index_may_contain(DiskIndex *ix, uint64_t key) {
+    uint64_t block[KEY_FILTER_BLOCK_WORDS];
+    if (!ix->meta.filter_blocks) return 1;
+    uint64_t h = key_filter_hash(key);
+    if (!filter_block_io(ix, key_filter_block(h, ix->meta.filter_blocks), block, 0)) return 1;
+    return key_filter_block_test(block, h, (int)ix->meta.filter_hashes);
+}
+
+// offsets of the entries for key, ascending, in a malloc'd *out; count, or -1 on an error
+static int disk_index_find(DiskIndex *ix, uint64_t key, uint64_t **out) {
+    IndexEntry want = {key, 0};
+    DiskPage page;
+    uint32_t p = ix->meta.root;
+    int n = 0, cap = 0, ok = 1;
+    *out = NULL;
+    for (uint32_t level = ix->meta.height; level > 1; --level) {
+        if (!page_read(ix, p, &page)) return -1;
+        p = page.u.node.child[node_upper_bound(&page, &want)];
+    }
+    // the run of equal keys may continue into the next leaves
+    while (ok && p) {
+        if (!page_read(ix, p, &page)) break;
+        uint32_t i = 0;
+        while (i < page.count && page.u.entries[i].key < key) i++;
+        for (; ok && i < page.count && page.u.entries[i].key == key; ++i) {
+            if (n == cap) {
+                cap = cap ? cap * 2 : 16;
+                uint64_t *v = realloc(*out, sizeof(uint64_t) * (size_t)cap);
+                ok = v != NULL;
+                if (!ok) break;
+                *out = v;
+            }
+            (*out)[n++] = page.u.entries[i].off;
+        }
+        p = i < page.count ? 0 : page.next;
+    }
+    if (ok && !p) return n;
+    free(*out);
+    *out = NULL;
+    return -1;
+}
+
+// add e, splitting full pages on the way back up; a split root adds a level
+static int disk_index_insert(DiskIndex *ix, IndexEntry e) {
+    uint32_t path[DISK_INDEX_MAX_HEIGHT];
+    int depth = 0;
+    DiskPage page, right;
+    uint32_t p = ix->meta.root;
+    for (uint32_t level = ix->meta.height; level > 1; --level) {
+        if (!page_read(ix, p, &page)) return 0;
+        path[depth++] = p;
+        p = page.u.node.child[node_upper_bound(&page, &e)];
+    }
+    if (!page_read(ix, p, &page)) return 0;
+    uint32_t at = page.count;
+    while (at > 0 && index_entry_cmp(&page.u.entries[at - 1], &e) > 0) at--;
+    if (page.count < DISK_LEAF_MAX) {
+        memmove(&page.u.entries[at + 1], &page.u.entries[at], sizeof(IndexEntry) * (page.count - at));
+        page.u.entries[at] = e;
+        page.count++;
+        return page_write(ix->f, p, &page);
+    }
+
+    IndexEntry all[DISK_LEAF_MAX + 1];
+    memcpy(all, page.u.entries, sizeof(IndexEntry) * at);
+    all[at] = e;
+    memcpy(all + at + 1, page.u.entries + at, sizeof(IndexEntry) * (DISK_LEAF_MAX - at));
+    // ascending inserts (new InspectionIDs) land past the last entry: keep the left page full
+    uint32_t keep = at == DISK_LEAF_MAX ? DISK_LEAF_MAX * DISK_BUILD_FILL / 100 : (DISK_LEAF_MAX + 1) / 2;
+    memset(&right, 0, sizeof(right));
+    right.type = DISK_PAGE_LEAF;
+    right.count = DISK_LEAF_MAX + 1 - keep;
+    right.next = page.next;
+    memcpy(right.u.entries, all + keep, sizeof(IndexEntry) * right.count);
+    page.count = keep;
+    memcpy(page.u.entries, all, sizeof(IndexEntry) * keep);
+    uint32_t child = ix->meta.npages++;
+    page.next = child;
+    if (!page_write(ix->f, child, &right) || !page_write(ix->f, p, &page)) return 0;
+    IndexEntry sep = right.u.entries[0];
+
+    while (depth > 0) {
+        p = path[--depth];
+        if (!page_read(ix, p, &page)) return 0;
+        uint32_t n = page.count, slot = node_upper_bound(&page, &sep);
+        IndexEntry keys[DISK_INTERNAL_MAX + 1];
+        uint32_t kids[DISK_INTERNAL_MAX + 2];
+        memcpy(keys, page.u.node.keys, sizeof(IndexEntry) * slot);
+        keys[slot] = sep;
+        memcpy(keys + slot + 1, page.u.node.keys + slot, sizeof(IndexEntry) * (n - slot));
+        memcpy(kids, page.u.node.child, sizeof(uint32_t) * (slot + 1));
+        kids[slot + 1] = child;
+        memcpy(kids + slot + 2, page.u.node.child + slot + 1, sizeof(uint32_t) * (n - slot));
+        n++;
+        if (n <= DISK_INTERNAL_MAX) {
+            page.count = n;
+            memcpy(page.u.node.keys, keys, sizeof(IndexEntry) * n);
+            memcpy(page.u.node.child, kids, sizeof(uint32_t) * (n + 1));
+            return page_write(ix->f, p, &page);
+        }
+        // keys[mid] moves up; the node keeps what is below it, a new right sibling the rest
+        uint32_t mid = n / 2;
+        memset(&right, 0, sizeof(right));
+        right.type = DISK_PAGE_INTERNAL;
+        right.count = n - mid - 1;
+        memcpy(right.u.node.keys, keys + mid + 1, sizeof(IndexEntry) * right.count);
+        memcpy(right.u.node.child, kids + mid + 1, sizeof(uint32_t) * (right.count + 1));
+        page.count = mid;
+        memcpy(page.u.node.keys, keys, sizeof(IndexEntry) * mid);
+        memcpy(page.u.node.child, kids, sizeof(uint32_t) * (mid + 1));
+        child = ix->meta.npages++;
+        if (!page_write(ix->f, child, &right) || !page_write(ix->f, p, &page)) return 0;
+        sep = keys[mid];
+    }
+
+    if (ix->meta.height == DISK_INDEX_MAX_HEIGHT) return 0;
+    memset(&page, 0, sizeof(page));
+    page.type = DISK_PAGE_INTERNAL;
+    page.count = 1;
+    page.u.node.keys[0] = sep;
+    page.u.node.child[0] = ix->meta.root;
+    page.u.node.child[1] = child;
+    ix->meta.root = ix->meta.npages++;
+    ix->meta.height++;
+    return page_write(ix->f, ix->meta.root, &page);
+}
+
+// insert the lines appended to csv since the index was last written. The meta page is
+// marked unclean first, so a crash half way leaves an index that reads as stale
+static int disk_index_catch_up(DiskIndex *ix, FILE *csv) {
+    EntryList l = {NULL, 0, 0};
+    uint64_t pos = ix->meta.data_bytes;
+    int ok = index_scan_lines(csv, &pos, &l);
+    if (!ok || pos == ix->meta.data_bytes) {
+        free(l.v);
+        return ok;
+    }
+    // a filter filling past its capacity loses its point: rebuild instead
+    ok = !ix->meta.filter_blocks || ix->meta.filter_keys + l.n <= ix->meta.filter_capacity;
+    ix->meta.clean = 0;
+    ok = ok && meta_write(ix->f, &ix->meta) && fflush(ix->f) == 0;
+    for (size_t i = 0; ok && i < l.n; ++i) {
+        ok = disk_index_insert(ix, l.v[i]);
+        if (ok && ix->meta.filter_blocks) {
+            uint64_t block[KEY_FILTER_BLOCK_WORDS], h = key_filter_hash(l.v[i].key);
+            uint32_t b = key_filter_block(h, ix->meta.filter_blocks);
+            ok = filter_block_io(ix, b, block, 0);
+            key_filter_block_set(block, h, (int)ix->meta.filter_hashes);
+            ok = ok && filter_block_io(ix, b, block, 1);
+        }
+    }
+    free(l.v);
+    if (!ok) return 0;
+    ix->meta.entries += l.n;
+    ix->meta.filter_keys += ix->meta.filter_blocks ? l.n : 0;
+    ix->meta.data_bytes = pos;
+    ix->meta.clean = csv_tail_hash(csv, pos, &ix->meta.tail_hash);
+    return meta_write(ix->f, &ix->meta) && ix->meta.clean;
+}
+
+// after csv_path was saved: bring its index (if it has one) up to date. Appended rows
+// are inserted; a rewrite that moved rows (rewritten), or an index that no longer matches,
+// means a rebuild. An index that cannot be fixed is deleted so lookups fall back to a scan
+int disk_index_refresh(const char *csv_path, int rewritten) {
+    char idx_path[MAX_LINE];
+    struct stat st;
+    disk_index_path(csv_path, idx_path, sizeof(idx_path));
+    if (stat(idx_path, &st) != 0) return 1; // not indexed
+    DiskIndex ix;
+    if (!rewritten && disk_index_open(&ix, csv_path, 1)) {
+        FILE *csv = fopen(csv_path, "rb");
+        int ok = csv && disk_index_matches(&ix, csv) && disk_index_catch_up(&ix, csv);
+        if (csv) fclose(csv);
+        if (disk_index_close(&ix) && ok) return 1;
+    }
+    if (disk_index_build(csv_path) >= 0) return 1;
+    remove(idx_path);
+    return 0;
+}
+
+// parse the row whose line starts at off; 0 if no line starts there
+static int csv_read_row_at(FILE *f, uint64_t off, Record *r) {
+    char line[MAX_LINE];
+    // read from the byte before: a line start follows a '\n'
+    if (file_seek(f, off ? off - 1 : 0) != 0 || (off && fgetc(f) != '\n')) return 0;
+    return fgets(line, sizeof(line), f) && strip_line_ending(line) && parse_record_line(line, r);
+}
+
+// append the rows matching key from f's current position to its end
+static int csv_scan_matches(FILE *f, const char *key, Record **v, int *n, int *cap) {
+    RecordList l = { *v, *n, *cap, 1 };
+    long found = csv_stream_search(f, key, 0, record_list_emit, &l, NULL);
+    *v = l.v;
+    *n = l.n;
+    *cap = l.cap;
+    return found >= 0 && l.ok;
+}
+
+// rows of csv_path whose InspectionID or CarRegNumber equals key (case-insensitive) by
+// reading the whole file, into a malloc'd *out; -1 if it cannot be read
+int csv_lookup_scan(const char *csv_path, const char *key, Record **out) {
+    int n = 0, cap = 0;
+    *out = NULL;
+    FILE *f = fopen(csv_path, "rb");
+    if (!f) return -1;
+    int ok = csv_scan_matches(f, key, out, &n, &cap);
+    fclose(f);
+    if (ok) return n;
+    free(*out);
+    *out = NULL;
+    return -1;
+}
+
+// the same rows through the index: a key filter probe, then (unless that rules the key
+// out) a root-to-leaf descent and the matching rows, then a scan of whatever was appended
+// after the index was last updated. -1 if there is no usable
+// index (missing, stale or unreadable) and the caller has to fall back to csv_lookup_scan
+int disk_index_lookup(const char *csv_path, const char *key, Record **out, long *pages_read) {
+    DiskIndex ix;
+    *out = NULL;
+    if (pages_read) *pages_read = 0;
+    if (!disk_index_open(&ix, csv_path, 0)) return -1;
+    FILE *csv = fopen(csv_path, "rb");
+    uint64_t k = disk_key(key), *offs = NULL;
+    int hits = -1;
+    if (csv && disk_index_matches(&ix, csv)) hits = disk_index_may_contain(&ix, k) ? disk_index_find(&ix, k, &offs) : 0;
+    disk_index_close(&ix);
+    if (pages_read) *pages_read = ix.pages_read;
+
+    int n = 0, cap = 0, ok = hits >= 0;
+    Record r;
+    for (int i = 0; ok && i < hits; ++i) {
+        if (csv_read_row_at(csv, offs[i], &r) && record_has_key(&r, key)) {
+            ok = record_list_push(out, &n, &cap, &r);
+        } else if (!(k & DISK_KEY_HASHED)) {
+            ok = 0; // a packed key cannot collide: the rows moved under the index
+        }
+    }
+    ok = ok && file_seek(csv, ix.meta.data_bytes) == 0 && csv_scan_matches(csv, key, out, &n, &cap);
+    free(offs);
+    if (csv) fclose(csv);
+    if (ok) return n;
+    free(*out);
+    *out = NULL;
+    return -1;
+}
+
+/* ---------- Partitioned layout (one CSV per month) ---------- */
+
+void partition_layout_init(PartitionLayout *pl, const char *dir) {
+    memset(pl, 0, sizeof(*pl));
+    snprintf(pl->dir, sizeof(pl->dir), "%s", dir);
+}
+
+void partition_layout_free(PartitionLayout *pl) {
+    char dir[PARTITION_DIR_LEN];
+    snprintf(dir, sizeof(dir), "%s", pl->dir);
+    free(pl->parts);
+    partition_layout_init(pl, dir);
+}
+
+// partition slot of a date_day_number
+int partition_slot(uint32_t day) {
+    int m = day == UINT32_MAX ? -1 : day_month_index(day);
+    return m < 0 ? PARTITION_UNDATED_SLOT : m;
+}
+
+// "2025-08", or "undated"
+void partition_name(int slot, char *out, size_t cap) {
+    if (slot == PARTITION_UNDATED_SLOT) snprintf(out, cap, "%s", PARTITION_UNDATED);
+    else snprintf(out, cap, "%04d-%02d", MIN_YEAR + slot / MONTHS_IN_YEAR, slot % MONTHS_IN_YEAR + 1);
+}
+
+// slot of a partition name; -1 if it is not one
+static int partition_parse_name(const char *s) {
+    if (strcmp(s, PARTITION_UNDATED) == 0) return PARTITION_UNDATED_SLOT;
+    int y, m;
+    char end;
+    if (sscanf(s, "%4d-%2d%c", &y, &m, &end) != 2 || y < MIN_YEAR || y > MAX_YEAR || m < 1 || m > MONTHS_IN_YEAR) return -1;
+    return (y - MIN_YEAR) * MONTHS_IN_YEAR + m - 1;
+}
+
+void partition_path(const PartitionLayout *pl, const PartitionInfo *p, char *out, size_t cap) {
+    char name[PARTITION_NAME_LEN];
+    partition_name(p->slot, name, sizeof(name));
+    snprintf(out, cap, "%s/%s%s.csv", pl->dir, p->archived ? PARTITION_ARCHIVE_DIR "/" : "", name);
+}
+
+static void partition_manifest_path(const PartitionLayout *pl, char *out, size_t cap) {
+    snprintf(out, cap, "%s/%s", pl->dir, PARTITION_MANIFEST);
+}
+
+// 1 when pl->dir holds a manifest, i.e. the data is partitioned
+int partition_layout_active(const PartitionLayout *pl) {
+    char path[MAX_LINE];
+    struct stat st;
+    partition_manifest_path(pl, path, sizeof(path));
+    return stat(path, &st) == 0;
+}
+
+static void partition_info_init(PartitionInfo *p, int slot, int archived) {
+    memset(p, 0, sizeof(*p));
+    p->slot = slot;
+    p->min_day = UINT32_MAX;
+    p->archived = archived;
+}
+
+// count a row and widen the date range
+static void partition_note_row(PartitionInfo *p, const char *date, uint32_t day) {
+    p->rows++;
+    if (day == UINT32_MAX) return;
+    if (day < p->min_day) {
+        p->min_day = day;
+        snprintf(p->min_date, sizeof(p->min_date), "%s", date);
+    }
+    if (day > p->max_day) {
+        p->max_day = day;
+        snprintf(p->max_date, sizeof(p->max_date), "%s", date);
+    }
+}
+
+static PartitionInfo *partition_find(PartitionLayout *pl, int slot, int archived) {
+    for (int i = 0; i < pl->count; ++i) {
+        if (pl->parts[i].slot == slot && pl->parts[i].archived == archived) return &pl->parts[i];
+    }
+    return NULL;
+}
+
+// replace the entry for p's slot and state with p (dropped when p has no rows); 0 when out of memory
+static int partition_put(PartitionLayout *pl, const PartitionInfo *p) {
+    int i = 0;
+    while (i < pl->count && (pl->parts[i].slot < p->slot ||
+                             (pl->parts[i].slot == p->slot && pl->parts[i].archived < p->archived))) {
+        i++;
+    }
+    int found = i < pl->count && pl->parts[i].slot == p->slot && pl->parts[i].archived == p->archived;
+    if (!p->rows) {
+        if (found) memmove(&pl->parts[i], &pl->parts[i + 1], sizeof(PartitionInfo) * (size_t)(--pl->count - i));
+        return 1;
+    }
+    if (!found) {
+        if (pl->count == pl->cap) {
+            int cap = pl->cap ? pl->cap * 2 : PARTITION_INITIAL_CAP;
+            PartitionInfo *v = realloc(pl->parts, sizeof(PartitionInfo) * (size_t)cap);
+            if (!v) return 0;
+            pl->parts = v;
+            pl->cap = cap;
+        }
+        memmove(&pl->parts[i + 1], &pl->parts[i], sizeof(PartitionInfo) * (size_t)(pl->count - i));
+        pl->count++;
+    }
+    pl->parts[i] = *p;
+    return 1;
+}
+
+// read the manifest into pl->parts; 0 if it is missing or malformed
+int partition_manifest_read(PartitionLayout *pl) {
+    char path[MAX_LINE], line[MAX_LINE], name[PARTITION_NAME_LEN], state[PARTITION_NAME_LEN];
+    partition_manifest_path(pl, path, sizeof(path));
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    pl->count = 0;
+    pl->manifest_hash = CSV_HASH_SEED;
+    int ok = 1;
+    while (ok && fgets(line, sizeof(line), f)) {
+        pl->manifest_hash = csv_hash(pl->manifest_hash, line, strlen(line));
+        if (line[0] == '#') {
+            pl->generation = strtoul(line + 1, NULL, 10);
+            continue;
+        }
+        if (!strip_line_ending(line)) continue;
+        PartitionInfo p;
+        partition_info_init(&p, 0, 0);
+        ok = sscanf(line, "%15[^,],%d,%14[^,],%14[^,],%15s", name, &p.rows, p.min_date, p.max_date, state) == 5 &&
+             (p.slot = partition_parse_name(name)) >= 0 && p.rows > 0;
+        if (!ok) break;
+        p.archived = strcmp(state, "archived") == 0;
+        p.min_day = date_day_number(p.min_date);
+        p.max_day = date_day_number(p.max_date);
+        if (p.min_day == UINT32_MAX || p.max_day == UINT32_MAX) { // "-": no dated rows
+            p.min_day = UINT32_MAX;
+            p.max_day = 0;
+            p.min_date[0] = p.max_date[0] = '\0';
+        }
+        ok = partition_put(pl, &p);
+    }
+    fclose(f);
+    return ok;
+}
+
+// write pl->parts as the manifest (temp file + rename); 1 on success
+int partition_manifest_write(PartitionLayout *pl) {
+    char path[MAX_LINE], tmp[MAX_LINE + sizeof(".tmp")], name[PARTITION_NAME_LEN], line[MAX_LINE];
+    partition_manifest_path(pl, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return 0;
+    int len = snprintf(line, sizeof(line), "#%lu\n", pl->generation + 1);
+    uint64_t h = csv_hash(CSV_HASH_SEED, line, (size_t)len);
+    fputs(line, f);
+    for (int i = 0; i < pl->count; ++i) {
+        const PartitionInfo *p = &pl->parts[i];
+        int dated = p->min_day <= p->max_day;
+        partition_name(p->slot, name, sizeof(name));
+        len = snprintf(line, sizeof(line), "%s,%d,%s,%s,%s\n", name, p->rows, dated ? p->min_date : "-",
+                       dated ? p->max_date : "-", p->archived ? "archived" : "hot");
+        fputs(line, f);
+        h = csv_hash(h, line, (size_t)len);
+    }
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    ok = ok && file_replace(tmp, path);
+    if (!ok) {
+        remove(tmp);
+        return 0;
+    }
+    pl->generation++;
+    pl->manifest_hash = h;
+    return 1;
+}
+
+// the store's sync state for the partitioned layout: it holds the hot partitions of the
+// manifest pl last read or wrote (ok = 0: it does not). The zero stamp never matches the
+// single file's, so after a merge that file is parsed in full
+static void partition_mark_synced(const PartitionLayout *pl, RecordStore *store, int ok) {
+    CsvSync *s = &store->csv;
+    memset(&s->stamp, 0, sizeof(s->stamp));
+    s->offset = 0;
+    s->hash = pl->manifest_hash;
+    s->version = ok ? store->version : 0;
+}
+
+// write the given store rows as the hot partition of slot and record it in pl->parts
+// (removing both when there are none); 1 on success
+static int partition_write_rows(PartitionLayout *pl, const RecordStore *store, int slot, const int *rows, int n) {
+    PartitionInfo p;
+    char path[MAX_LINE], tmp[MAX_LINE + sizeof(".tmp")];
+    partition_info_init(&p, slot, 0);
+    partition_path(pl, &p, path, sizeof(path));
+    if (n == 0) {
+        remove(path);
+        return partition_put(pl, &p);
+    }
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return 0;
+    for (int i = 0; i < n; ++i) {
+        const StoredRow *r = &store->rows[rows[i]];
+        fprintf(f, "%s,%s,%s,%s\n", r->inspectionID, r->carReg, store_owner(store, rows[i]), r->date);
+        partition_note_row(&p, r->date, store->day_keys[rows[i]]);
+    }
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    ok = ok && file_replace(tmp, path);
+    if (!ok) {
+        remove(tmp);
+        return 0;
+    }
+    return partition_put(pl, &p);
+}
+
+// rewrite the hot partition of slot from the store
+static int partition_rewrite(PartitionLayout *pl, const RecordStore *store, int slot) {
+    int *rows = malloc(sizeof(int) * (size_t)(store->count ? store->count : 1));
+    if (!rows) return 0;
+    int n = 0;
+    for (int i = 0; i < store->count; ++i) {
+        if (partition_slot(store->day_keys[i]) == slot) rows[n++] = i;
+    }
+    int ok = partition_write_rows(pl, store, slot, rows, n);
+    free(rows);
+    pl->rewrites++;
+    return ok;
+}
+
+// write every row of the store into its month's partition under pl->dir and switch to
+// the partitioned layout; the single file flat_path and its index are removed once the
+// manifest is in place. Returns the number of partitions, -1 on failure
+int partition_split(PartitionLayout *pl, RecordStore *store, const char *flat_path) {
+    if (!make_dir(pl->dir)) return -1;
+    // counting sort of the rows by slot, so each partition is written in one pass
+    int *start = calloc(PARTITION_SLOTS + 1, sizeof(int));
+    int *order = malloc(sizeof(int) * (size_t)(store->count ? store->count : 1));
+    if (!start || !order) {
+        free(start);
+        free(order);
+        return -1;
+    }
+    for (int i = 0; i < store->count; ++i) start[partition_slot(store->day_keys[i]) + 1]++;
+    for (int s = 0; s < PARTITION_SLOTS; ++s) start[s + 1] += start[s];
+    for (int i = 0; i < store->count; ++i) order[start[partition_slot(store->day_keys[i])]++] = i;
+    pl->count = 0;
+    int ok = 1, from = 0;
+    for (int s = 0; ok && s < PARTITION_SLOTS; ++s) { // start[s] is now the end of slot s
+        if (start[s] > from) ok = partition_write_rows(pl, store, s, order + from, start[s] - from);
+        from = start[s];
+    }
+    free(start);
+    free(order);
+    if (!ok || !partition_manifest_write(pl)) return -1;
+    char idx_path[MAX_LINE];
+    disk_index_path(flat_path, idx_path, sizeof(idx_path));
+    remove(flat_path);
+    remove(idx_path);
+    partition_mark_synced(pl, store, 1);
+    return pl->count;
+}
+
+// keep "path: reason" in pl->error for the caller to report
+static void partition_error(PartitionLayout *pl, const char *path, int err) {
+    snprintf(pl->error, sizeof(pl->error), "%s: %s", path, strerror(err));
+}
+
+// append one partition file's rows to the store; 0 when out of memory
+static int partition_parse_file(PartitionLayout *pl, RecordStore *store, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        partition_error(pl, path, errno);
+        return 1; // a missing partition loses its rows, not the others
+    }
+    char line[MAX_LINE];
+    Record r;
+    int ok = 1;
+    while (ok && fgets(line, sizeof(line), f)) {
+        if (!strip_line_ending(line) || !parse_record_line(line, &r)) continue;
+        ok = store_append(store, &r);
+    }
+    fclose(f);
+    if (!ok) snprintf(pl->error, sizeof(pl->error), "Out of memory after %d records.", store->count);
+    return ok;
+}
+
+// bring the store in line with the hot partitions and return its row count (-1 without a
+// valid manifest). Only the manifest is read while it is the one we last loaded or wrote;
+// what went wrong is left in pl->error
+int partition_load(PartitionLayout *pl, RecordStore *store) {
+    char path[MAX_LINE];
+    CsvSync *s = &store->csv;
+    pl->error[0] = '\0';
+    if (!partition_manifest_read(pl)) {
+        partition_manifest_path(pl, path, sizeof(path));
+        snprintf(pl->error, sizeof(pl->error), "%s is missing or not a valid manifest.", path);
+        s->version = 0;
+        return -1;
+    }
+    if (s->version != 0 && s->version == store->version && s->hash == pl->manifest_hash) {
+        s->skipped_loads++;
+        return store->count;
+    }
+    store_reset_rows(store);
+    int ok = 1;
+    for (int i = 0; ok && i < pl->count; ++i) {
+        if (pl->parts[i].archived) continue;
+        partition_path(pl, &pl->parts[i], path, sizeof(path));
+        ok = partition_parse_file(pl, store, path);
+        pl->files_read++;
+    }
+    store_build_filter(store);
+    s->full_loads++;
+    partition_mark_synced(pl, store, ok);
+    return store->count;
+}
+
+// persist a change already applied to store: an add whose month already has a hot
+// partition and is the only one that grew is appended; otherwise every partition whose
+// row count moved is rewritten, plus the updated row's own
+int partition_commit(PartitionLayout *pl, RecordStore *store, int kind, const Record *r) {
+    int *live = calloc(PARTITION_SLOTS, sizeof(int));
+    int *held = calloc(PARTITION_SLOTS, sizeof(int));
+    if (!live || !held) {
+        free(live);
+        free(held);
+        return 0;
+    }
+    for (int i = 0; i < store->count; ++i) live[partition_slot(store->day_keys[i])]++;
+    for (int i = 0; i < pl->count; ++i) {
+        if (!pl->parts[i].archived) held[pl->parts[i].slot] = pl->parts[i].rows;
+    }
+    int target = r ? partition_slot(date_day_number(r->date)) : -1, moved = 0, last = -1;
+    for (int s = 0; s < PARTITION_SLOTS; ++s) {
+        if (live[s] != held[s]) {
+            moved++;
+            last = s;
+        }
+    }
+    int ok = 1;
+    PartitionInfo *p = kind == PERSIST_ADD ? partition_find(pl, target, 0) : NULL;
+    if (p && moved == 1 && last == target && live[target] == p->rows + 1) {
+        char path[MAX_LINE];
+        partition_path(pl, p, path, sizeof(path));
+        FILE *f = fopen(path, "a");
+        ok = f && fprintf(f, "%s,%s,%s,%s\n", r->inspectionID, r->carReg, r->owner, r->date) > 0;
+        if (f && fclose(f) != 0) ok = 0;
+        if (ok) partition_note_row(p, r->date, date_day_number(r->date));
+        pl->appends++;
+    } else {
+        for (int s = 0; s < PARTITION_SLOTS; ++s) {
+            if (live[s] != held[s] || (kind == PERSIST_SET && s == target)) ok = partition_rewrite(pl, store, s) && ok;
+        }
+    }
+    free(live);
+    free(held);
+    ok = ok && partition_manifest_write(pl);
+    partition_mark_synced(pl, store, ok);
+    return ok;
+}
+
+// append the bytes of file from to file to; 1 on success
+static int file_copy_append(const char *from, const char *to) {
+    FILE *in = fopen(from, "rb");
+    FILE *out = in ? fopen(to, "ab") : NULL;
+    char buf[CSV_VERIFY_BLOCK];
+    size_t n;
+    int ok = out != NULL;
+    while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0) ok = fwrite(buf, 1, n, out) == n;
+    if (in) ok = ok && !ferror(in);
+    if (in) fclose(in);
+    if (out && fclose(out) != 0) ok = 0;
+    return ok;
+}
+
+// move the hot partitions of months before slot `before` into archive/ (into the month's
+// archived partition when it has one); the hot partitions of later months are not opened.
+// The store drops the archived rows on its next load. Returns the number moved, -1 on failure
+int partition_archive(PartitionLayout *pl, int before) {
+    char dir[MAX_LINE], from[MAX_LINE], to[MAX_LINE];
+    if (!partition_manifest_read(pl)) return -1;
+    snprintf(dir, sizeof(dir), "%s/%s", pl->dir, PARTITION_ARCHIVE_DIR);
+    int moved = 0, ok = 1;
+    for (int i = 0; ok && i < pl->count; ++i) {
+        PartitionInfo p = pl->parts[i];
+        if (p.archived || p.slot >= before || p.slot == PARTITION_UNDATED_SLOT) continue;
+        ok = make_dir(dir);
+        partition_path(pl, &p, from, sizeof(from));
+        PartitionInfo *a = partition_find(pl, p.slot, 1);
+        if (a) {
+            partition_path(pl, a, to, sizeof(to));
+            ok = ok && file_copy_append(from, to);
+            if (!ok) break;
+            remove(from);
+            a->rows += p.rows;
+            if (p.min_day < a->min_day) {
+                a->min_day = p.min_day;
+                memcpy(a->min_date, p.min_date, sizeof(a->min_date));
+            }
+            if (p.max_day > a->max_day && p.min_day <= p.max_day) {
+                a->max_day = p.max_day;
+                memcpy(a->max_date, p.max_date, sizeof(a->max_date));
+            }
+            p.rows = 0;
+            partition_put(pl, &p); // drops the hot entry; the archived one moves up to i
+        } else {
+            pl->parts[i].archived = 1;
+            partition_path(pl, &pl->parts[i], to, sizeof(to));
+            ok = ok && rename(from, to) == 0;
+            if (!ok) {
+                pl->parts[i].archived = 0;
+                break;
+            }
+        }
+        moved++;
+    }
+    if (!partition_manifest_write(pl)) ok = 0; // records whatever moved before a failure
+    return ok ? moved : -1;
+}
+
+// back to a single file: every partition, archived ones included, oldest month first,
+// into flat_path; then the partition files and the manifest are removed. Returns the row
+// count, -1 on failure (the partitions are left as they were)
+long partition_merge(PartitionLayout *pl, const char *flat_path) {
+    char tmp[MAX_LINE], path[MAX_LINE];
+    if (!partition_manifest_read(pl)) return -1;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", flat_path);
+    remove(tmp);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return -1;
+    fclose(f);
+    long rows = 0;
+    int ok = 1;
+    for (int i = 0; ok && i < pl->count; ++i) {
+        partition_path(pl, &pl->parts[i], path, sizeof(path));
+        ok = file_copy_append(path, tmp);
+        rows += pl->parts[i].rows;
+    }
+    ok = ok && file_replace(tmp, flat_path);
+    if (!ok) {
+        remove(tmp);
+        return -1;
+    }
+    partition_manifest_path(pl, path, sizeof(path));
+    remove(path);
+    for (int i = 0; i < pl->count; ++i) {
+        partition_path(pl, &pl->parts[i], path, sizeof(path));
+        remove(path);
+    }
+    snprintf(path, sizeof(path), "%s/%s", pl->dir, PARTITION_ARCHIVE_DIR);
+    dir_remove(path);
+    dir_remove(pl->dir);
+    pl->count = 0;
+    return rows;
+}
+
+// rows of fp dated from..to (date_day_numbers, inclusive), each passed to emit; returns the count
+long csv_range_scan(FILE *fp, uint32_t from, uint32_t to, RecordFn emit, void *ctx) {
+    char line[MAX_LINE];
+    Record r;
+    long n = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strip_line_ending(line) || !parse_record_line(line, &r)) continue;
+        uint32_t day = date_day_number(r.date);
+        if (day < from || day > to) continue;
+        if (emit) emit(&r, ctx);
+        n++;
+    }
+    return n;
+}
+
+// the same over the partitions, archived ones included: only those whose date range
+// overlaps from..to are opened. Returns the count, -1 without a manifest; a partition
+// that cannot be opened is skipped and named in pl->error
+long partition_range(PartitionLayout *pl, uint32_t from, uint32_t to, RecordFn emit, void *ctx) {
+    char path[MAX_LINE];
+    pl->error[0] = '\0';
+    if (!partition_manifest_read(pl)) return -1;
+    long n = 0;
+    for (int i = 0; i < pl->count; ++i) {
+        const PartitionInfo *p = &pl->parts[i];
+        if (p->min_day > to || p->max_day < from) {
+            pl->files_pruned++;
+            continue;
+        }
+        partition_path(pl, p, path, sizeof(path));
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            partition_error(pl, path, errno);
+            continue;
+        }
+        n += csv_range_scan(f, from, to, emit, ctx);
+        fclose(f);
+        pl->files_read++;
+    }
+    return n;
+}
+
+/* ---------- Columnar archive (compressed cold history) ---------- */
+
+typedef struct {
+    uint32_t rows;
+    uint32_t min_day, max_day; // date_day_number range, UINT32_MAX for undated rows
+    uint32_t bytes[COLUMN_COUNT]; // segment sizes, in column order
+} ColumnBlockHeader;
+
+// users_data.csv -> users_data.icol
+void column_archive_path(const char *csv_path, char *out, size_t cap) {
+    size_t len = strlen(csv_path);
+    if (len >= 4 && strcasecmp(csv_path + len - 4, ".csv") == 0) len -= 4;
+    snprintf(out, cap, "%.*s%s", (int)len, csv_path, COLUMN_ARCHIVE_EXT);
+}
+
+static uint32_t zigzag_encode(int64_t d) {
+    return (uint32_t)(d >= 0 ? 2 * d : -2 * d - 1);
+}
+
+static int64_t zigzag_decode(uint32_t z) {
+    return (z & 1) ? -(int64_t)(z >> 1) - 1 : (int64_t)(z >> 1);
+}
+
+// DD/MM/YYYY of a date_day_number; the inverse of date_day_number for valid dates
+void day_number_date(uint32_t day, char *out) {
+    long z = (long)day + days_from_civil(MIN_YEAR, 1, 1); // days since 01/03/0000, as days_from_civil counts
+    long era = z / 146097;
+    long doe = z - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    int d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    int m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    int y = (int)(yoe + era * 400 + (m <= 2));
+    out[0] = (char)('0' + d / 10);
+    out[1] = (char)('0' + d % 10);
+    out[2] = '/';
+    out[3] = (char)('0' + m / 10);
+    out[4] = (char)('0' + m % 10);
+    out[5] = '/';
+    out[6] = (char)('0' + y / 1000 % 10);
+    out[7] = (char)('0' + y / 100 % 10);
+    out[8] = (char)('0' + y / 10 % 10);
+    out[9] = (char)('0' + y % 10);
+    out[10] = '\0';
+}
+
+// the trailing run of up to COLUMN_DIGITS digits of s as a number; *prefix_len is the length before it
+static uint32_t column_split(const char *s, uint32_t *prefix_len, uint32_t *digits) {
+    size_t len = strlen(s), d = 0;
+    while (d < COLUMN_DIGITS && d < len && CHAR_IS(s[len - 1 - d], CC_DIGIT)) d++;
+    uint32_t v = 0;
+    for (size_t i = len - d; i < len; ++i) v = v * 10 + (uint32_t)(s[i] - '0');
+    *prefix_len = (uint32_t)(len - d);
+    *digits = (uint32_t)d;
+    return v;
+}
+
+/* encoding */
+
+typedef struct {
+    FILE *f;
+    ColumnArchiveMeta meta;
+    Record *rows; // the block being filled
+    int n;
+    unsigned char *seg; // one encoded column
+    size_t len;
+    uint32_t *num, *digits, *plen, *codes;
+    const char **strs; // per row, the string to dictionary code
+    const char **dict;
+    int *slots; // dictionary hash table, -1 = empty
+    int failed;
+} ColumnWriter;
+
+static void column_put(ColumnWriter *w, const void *src, size_t n) {
+    memcpy(w->seg + w->len, src, n);
+    w->len += n;
+}
+
+// frame-of-reference bit-pack v[0..n)
+static void column_pack(ColumnWriter *w, const uint32_t *v, int n) {
+    uint32_t lo = n ? UINT32_MAX : 0, hi = 0;
+    for (int i = 0; i < n; ++i) {
+        if (v[i] < lo) lo = v[i];
+        if (v[i] > hi) hi = v[i];
+    }
+    unsigned char width = 0;
+    while (width < 32 && (hi - lo) >> width) width++;
+    column_put(w, &lo, sizeof(lo));
+    column_put(w, &width, 1);
+    uint64_t acc = 0;
+    int bits = 0;
+    for (int i = 0; i < n; ++i) {
+        acc |= (uint64_t)(v[i] - lo) << bits;
+        bits += width;
+        while (bits >= 8) {
+            w->seg[w->len++] = (unsigned char)acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    if (bits > 0) w->seg[w->len++] = (unsigned char)acc;
+}
+
+// dictionary-code w->strs[0..n), each taken for its first plen[i] bytes (all of it when plen is NULL)
+static void column_put_dict(ColumnWriter *w, const uint32_t *plen, int n) {
+    uint32_t count = 0;
+    for (int i = 0; i < 2 * COLUMN_BLOCK_ROWS; ++i) w->slots[i] = -1;
+    size_t at = w->len;
+    column_put(w, &count, sizeof(count));
+    for (int i = 0; i < n; ++i) {
+        const char *s = w->strs[i];
+        size_t len = plen ? plen[i] : strlen(s);
+        uint64_t h = csv_hash(CSV_HASH_SEED, s, len);
+        int slot = (int)(h & (2 * COLUMN_BLOCK_ROWS - 1));
+        while (w->slots[slot] >= 0) {
+            const char *e = w->dict[w->slots[slot]];
+            if (strncmp(e, s, len) == 0 && e[len] == '\0') break;
+            slot = (slot + 1) & (2 * COLUMN_BLOCK_ROWS - 1);
+        }
+        if (w->slots[slot] < 0) {
+            w->slots[slot] = (int)count;
+            w->dict[count++] = (const char *)w->seg + w->len; // the copy, NUL-terminated
+            column_put(w, s, len);
+            w->seg[w->len++] = '\0';
+        }
+        w->codes[i] = (uint32_t)w->slots[slot];
+    }
+    memcpy(w->seg + at, &count, sizeof(count));
+    column_pack(w, w->codes, n);
+}
+
+// InspectionID (delta) or CarRegNumber column of the block
+static void column_encode_split(ColumnWriter *w, int field, int delta) {
+    for (int i = 0; i < w->n; ++i) {
+        w->strs[i] = field == QUERY_FIELD_ID ? w->rows[i].inspectionID : w->rows[i].carReg;
+        w->num[i] = column_split(w->strs[i], &w->plen[i], &w->digits[i]);
+    }
+    column_put_dict(w, w->plen, w->n);
+    column_pack(w, w->digits, w->n);
+    if (!delta) {
+        column_pack(w, w->num, w->n);
+        return;
+    }
+    // codes hold each row's prefix; a row continues the run of the row before when they share it
+    uint32_t first = w->n ? w->num[0] : 0, prev = first;
+    column_put(w, &first, sizeof(first));
+    for (int i = 0; i < w->n; ++i) {
+        uint32_t v = w->num[i];
+        if (i > 0 && w->codes[i] != w->codes[i - 1]) prev = 0;
+        w->num[i] = zigzag_encode((int64_t)v - prev);
+        prev = v;
+    }
+    column_pack(w, w->num, w->n);
+}
+
+static void column_encode_date(ColumnWriter *w, ColumnBlockHeader *h) {
+    char date[DATE_BUFFER_LEN];
+    int plain = 1;
+    h->min_day = UINT32_MAX;
+    h->max_day = 0;
+    for (int i = 0; i < w->n; ++i) {
+        uint32_t day = date_day_number(w->rows[i].date);
+        if (day < h->min_day) h->min_day = day;
+        if (day > h->max_day) h->max_day = day;
+        if (plain && day != UINT32_MAX) day_number_date(day, date);
+        plain = plain && day != UINT32_MAX && strcmp(date, w->rows[i].date) == 0;
+        w->num[i] = day;
+    }
+    size_t start = w->len, delta_len = SIZE_MAX;
+    if (plain && w->n) {
+        unsigned char kind = COLUMN_DATE_DELTA;
+        uint32_t first = w->num[0];
+        column_put(w, &kind, 1);
+        column_put(w, &first, sizeof(first));
+        for (int i = w->n - 1; i > 0; --i) w->num[i] = zigzag_encode((int64_t)w->num[i] - w->num[i - 1]);
+        w->num[0] = 0;
+        column_pack(w, w->num, w->n);
+        delta_len = w->len - start;
+    }
+    // the dictionary goes after the deltas and replaces them when it is smaller
+    size_t dict_start = w->len;
+    unsigned char kind = COLUMN_DATE_DICT;
+    for (int i = 0; i < w->n; ++i) w->strs[i] = w->rows[i].date;
+    column_put(w, &kind, 1);
+    column_put_dict(w, NULL, w->n);
+    if (w->len - dict_start < delta_len) {
+        memmove(w->seg + start, w->seg + dict_start, w->len - dict_start);
+        w->len = start + (w->len - dict_start);
+    } else {
+        w->len = dict_start;
+    }
+}
+
+// encode and write the rows collected so far as one block
+static void column_flush_block(ColumnWriter *w) {
+    if (w->n == 0 || w->failed) return;
+    ColumnBlockHeader h;
+    memset(&h, 0, sizeof(h));
+    h.rows = (uint32_t)w->n;
+    w->len = 0;
+    column_encode_split(w, QUERY_FIELD_ID, 1);
+    h.bytes[QUERY_FIELD_ID] = (uint32_t)w->len;
+    column_encode_split(w, QUERY_FIELD_PLATE, 0);
+    h.bytes[QUERY_FIELD_PLATE] = (uint32_t)w->len - h.bytes[QUERY_FIELD_ID];
+    size_t before = w->len;
+    for (int i = 0; i < w->n; ++i) w->strs[i] = w->rows[i].owner;
+    column_put_dict(w, NULL, w->n);
+    h.bytes[QUERY_FIELD_OWNER] = (uint32_t)(w->len - before);
+    before = w->len;
+    column_encode_date(w, &h);
+    h.bytes[QUERY_FIELD_DATE] = (uint32_t)(w->len - before);
+    if (fwrite(&h, sizeof(h), 1, w->f) != 1 || fwrite(w->seg, 1, w->len, w->f) != w->len) w->failed = 1;
+    for (int c = 0; c < COLUMN_COUNT; ++c) w->meta.column_bytes[c] += h.bytes[c];
+    w->meta.blocks++;
+    w->meta.rows += (uint64_t)w->n;
+    w->n = 0;
+}
+
+static void column_writer_free(ColumnWriter *w) {
+    free(w->rows);
+    free(w->seg);
+    free(w->num);
+    free(w->digits);
+    free(w->plen);
+    free(w->codes);
+    free(w->strs);
+    free(w->dict);
+    free(w->slots);
+}
+
+static int column_writer_init(ColumnWriter *w, FILE *f) {
+    memset(w, 0, sizeof(*w));
+    w->f = f;
+    memcpy(w->meta.magic, COLUMN_ARCHIVE_MAGIC, sizeof(w->meta.magic));
+    w->meta.block_rows = COLUMN_BLOCK_ROWS;
+    w->rows = malloc(sizeof(Record) * COLUMN_BLOCK_ROWS);
+    w->seg = malloc(COLUMN_SEGMENT_MAX);
+    w->num = malloc(sizeof(uint32_t) * COLUMN_BLOCK_ROWS);
+    w->digits = malloc(sizeof(uint32_t) * COLUMN_BLOCK_ROWS);
+    w->plen = malloc(sizeof(uint32_t) * COLUMN_BLOCK_ROWS);
+    w->codes = malloc(sizeof(uint32_t) * COLUMN_BLOCK_ROWS);
+    w->strs = malloc(sizeof(char *) * COLUMN_BLOCK_ROWS);
+    w->dict = malloc(sizeof(char *) * COLUMN_BLOCK_ROWS);
+    w->slots = malloc(sizeof(int) * 2 * COLUMN_BLOCK_ROWS);
+    if (!w->rows || !w->seg || !w->num || !w->digits || !w->plen || !w->codes || !w->strs || !w->dict || !w->slots) {
+        column_writer_free(w);
+        return 0;
+    }
+    // the meta is rewritten at the end, once the counts are known
+    return fwrite(&w->meta, sizeof(w->meta), 1, f) == 1;
+}
+
+// compress the CSV at csv_path into a columnar archive at out_path (written beside it and
+// renamed over it), one block in memory at a time. Returns the row count, -1 on failure
+long column_archive_pack(const char *csv_path, const char *out_path) {
+    char tmp[MAX_LINE + sizeof(".tmp")], line[MAX_LINE];
+    FILE *in = fopen(csv_path, "r");
+    if (!in) return -1;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", out_path);
+    FILE *out = fopen(tmp, "wb");
+    ColumnWriter w;
+    if (!out || !column_writer_init(&w, out)) {
+        if (out) fclose(out);
+        fclose(in);
+        remove(tmp);
+        return -1;
+    }
+    while (!w.failed && fgets(line, sizeof(line), in)) {
+        w.meta.source_bytes += strlen(line);
+        if (!strip_line_ending(line) || !parse_record_line(line, &w.rows[w.n])) continue;
+        if (++w.n == COLUMN_BLOCK_ROWS) column_flush_block(&w);
+    }
+    column_flush_block(&w);
+    int ok = !w.failed && !ferror(in);
+    ok = ok && file_seek(out, 0) == 0 && fwrite(&w.meta, sizeof(w.meta), 1, out) == 1;
+    long rows = (long)w.meta.rows;
+    column_writer_free(&w);
+    fclose(in);
+    if (fclose(out) != 0) ok = 0;
+    ok = ok && file_replace(tmp, out_path);
+    if (!ok) {
+        remove(tmp);
+        return -1;
+    }
+    return rows;
+}
+
+/* decoding */
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    int bad; // ran past the segment or met a value out of range
+} ColumnCursor;
+
+static int column_take(ColumnCursor *c, void *dst, size_t n) {
+    if (c->bad || (size_t)(c->end - c->p) < n) {
+        c->bad = 1;
+        return 0;
+    }
+    memcpy(dst, c->p, n);
+    c->p += n;
+    return 1;
+}
+
+static void column_unpack(ColumnCursor *c, uint32_t *v, int n) {
+    uint32_t lo;
+    unsigned char width;
+    if (!column_take(c, &lo, sizeof(lo)) || !column_take(c, &width, 1)) return;
+    size_t bytes = ((size_t)n * width + 7) / 8;
+    if (width > 32 || (size_t)(c->end - c->p) < bytes) {
+        c->bad = 1;
+        return;
+    }
+    const unsigned char *p = c->p;
+    uint64_t acc = 0, mask = (1ULL << width) - 1;
+    int bits = 0;
+    for (int i = 0; i < n; ++i) {
+        while (bits < width) {
+            acc |= (uint64_t)*p++ << bits;
+            bits += 8;
+        }
+        v[i] = lo + (uint32_t)(acc & mask);
+        acc >>= width;
+        bits -= width;
+    }
+    c->p += bytes;
+}
+
+// the dictionary's strings into dict (at most n of them), then the n codes; returns the count
+static uint32_t column_take_dict(ColumnCursor *c, const char **dict, uint32_t *codes, int n) {
+    uint32_t count;
+    if (!column_take(c, &count, sizeof(count)) || count > (uint32_t)n) {
+        c->bad = 1;
+        return 0;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        const unsigned char *nul = memchr(c->p, '\0', (size_t)(c->end - c->p));
+        if (!nul) {
+            c->bad = 1;
+            return 0;
+        }
+        dict[i] = (const char *)c->p;
+        c->p = nul + 1;
+    }
+    column_unpack(c, codes, n);
+    for (int i = 0; i < n && !c->bad; ++i) c->bad = codes[i] >= count;
+    return count;
+}
+
+typedef struct {
+    FILE *f;
+    ColumnArchiveMeta meta;
+    Record *rows;
+    unsigned char *seg;
+    uint32_t *num, *digits, *codes;
+    const char **dict;
+    unsigned char *entry_hit; // per dictionary entry, while matching a segment
+} ColumnReader;
+
+// copy a dictionary entry into a field of cap bytes
+static int column_field_copy(char *dst, size_t cap, const char *src) {
+    size_t len = strlen(src);
+    if (len >= cap) return 0;
+    memcpy(dst, src, len + 1);
+    return 1;
+}
+
+// the prefix codes, digit counts and numbers of an InspectionID or CarRegNumber segment
+// into rd->codes, rd->digits and rd->num (IDs with their deltas undone); the dictionary size
+static uint32_t column_take_split(ColumnReader *rd, ColumnCursor *c, int field, int n) {
+    uint32_t count = column_take_dict(c, rd->dict, rd->codes, n), prev = 0;
+    column_unpack(c, rd->digits, n);
+    if (field == QUERY_FIELD_ID) column_take(c, &prev, sizeof(prev));
+    column_unpack(c, rd->num, n);
+    if (field != QUERY_FIELD_ID || c->bad) return count;
+    for (int i = 0; i < n; ++i) {
+        if (i > 0 && rd->codes[i] != rd->codes[i - 1]) prev = 0;
+        if (i > 0) prev = (uint32_t)((int64_t)prev + zigzag_decode(rd->num[i]));
+        rd->num[i] = prev;
+    }
+    return count;
+}
+
+// decode one segment of n rows into the field of rd->rows it belongs to; 0 if it is damaged
+static int column_decode(ColumnReader *rd, int field, const unsigned char *seg, size_t len, int n) {
+    ColumnCursor c = {seg, seg + len, 0};
+    Record *rows = rd->rows;
+    if (field == QUERY_FIELD_ID || field == QUERY_FIELD_PLATE) {
+        size_t cap = field == QUERY_FIELD_ID ? sizeof(rows->inspectionID) : sizeof(rows->carReg);
+        column_take_split(rd, &c, field, n);
+        for (int i = 0; i < n && !c.bad; ++i) {
+            char *dst = field == QUERY_FIELD_ID ? rows[i].inspectionID : rows[i].carReg;
+            const char *prefix = rd->dict[rd->codes[i]];
+            size_t plen = strlen(prefix), d = rd->digits[i];
+            uint32_t v = rd->num[i];
+            if (d > COLUMN_DIGITS || plen + d >= cap) {
+                c.bad = 1;
+                break;
+            }
+            memcpy(dst, prefix, plen);
+            for (size_t k = plen + d; k > plen; --k) {
+                dst[k - 1] = (char)('0' + v % 10);
+                v /= 10;
+            }
+            dst[plen + d] = '\0';
+        }
+    } else if (field == QUERY_FIELD_OWNER) {
+        column_take_dict(&c, rd->dict, rd->codes, n);
+        for (int i = 0; i < n && !c.bad; ++i) c.bad = !column_field_copy(rows[i].owner, sizeof(rows[i].owner), rd->dict[rd->codes[i]]);
+    } else {
+        unsigned char kind = 0;
+        column_take(&c, &kind, 1);
+        if (kind == COLUMN_DATE_DELTA) {
+            uint32_t day = 0;
+            column_take(&c, &day, sizeof(day));
+            column_unpack(&c, rd->num, n);
+            for (int i = 0; i < n && !c.bad; ++i) {
+                day = (uint32_t)((int64_t)day + zigzag_decode(rd->num[i]));
+                day_number_date(day, rows[i].date);
+            }
+        } else if (kind == COLUMN_DATE_DICT) {
+            column_take_dict(&c, rd->dict, rd->codes, n);
+            for (int i = 0; i < n && !c.bad; ++i) c.bad = !column_field_copy(rows[i].date, sizeof(rows[i].date), rd->dict[rd->codes[i]]);
+        } else {
+            c.bad = 1;
+        }
+    }
+    return !c.bad;
+}
+
+// set hit[i] for the rows of an InspectionID or CarRegNumber segment equal to key in any
+// case, comparing the key's prefix with each dictionary entry once and its number with the
+// packed numbers, without building the strings; 0 if the segment is damaged
+static int column_match_key(ColumnReader *rd, int field, const unsigned char *seg, size_t len, int n, const char *key,
+                            unsigned char *hit) {
+    ColumnCursor c = {seg, seg + len, 0};
+    uint32_t count = column_take_split(rd, &c, field, n);
+    if (c.bad) return 0;
+    uint32_t kplen, kdigits, kv = column_split(key, &kplen, &kdigits);
+    int any = 0;
+    for (uint32_t e = 0; e < count; ++e) {
+        rd->entry_hit[e] = strlen(rd->dict[e]) == kplen && strncasecmp(rd->dict[e], key, kplen) == 0;
+        any |= rd->entry_hit[e];
+    }
+    for (int i = 0; i < n && any; ++i) {
+        hit[i] |= rd->entry_hit[rd->codes[i]] && rd->digits[i] == kdigits && rd->num[i] == kv;
+    }
+    return 1;
+}
+
+// clear match[i] for the rows of an InspectionDate segment dated outside from..to, on the
+// day numbers themselves (or once per dictionary entry); 0 if the segment is damaged
+static int column_match_days(ColumnReader *rd, const unsigned char *seg, size_t len, int n, uint32_t from, uint32_t to,
+                             unsigned char *match) {
+    ColumnCursor c = {seg, seg + len, 0};
+    unsigned char kind = 0;
+    column_take(&c, &kind, 1);
+    if (kind == COLUMN_DATE_DELTA) {
+        uint32_t day = 0;
+        column_take(&c, &day, sizeof(day));
+        column_unpack(&c, rd->num, n);
+        for (int i = 0; i < n && !c.bad; ++i) {
+            day = (uint32_t)((int64_t)day + zigzag_decode(rd->num[i]));
+            match[i] &= day >= from && day <= to;
+        }
+    } else if (kind == COLUMN_DATE_DICT) {
+        uint32_t count = column_take_dict(&c, rd->dict, rd->codes, n);
+        for (uint32_t e = 0; e < count && !c.bad; ++e) {
+            uint32_t day = date_day_number(rd->dict[e]);
+            rd->entry_hit[e] = day >= from && day <= to;
+        }
+        for (int i = 0; i < n && !c.bad; ++i) match[i] &= rd->entry_hit[rd->codes[i]];
+    } else {
+        c.bad = 1;
+    }
+    return !c.bad;
+}
+
+static void column_reader_close(ColumnReader *rd) {
+    if (rd->f) fclose(rd->f);
+    free(rd->rows);
+    free(rd->seg);
+    free(rd->num);
+    free(rd->digits);
+    free(rd->codes);
+    free(rd->dict);
+    free(rd->entry_hit);
+}
+
+// open path and check its meta; 0 if it is missing, not an archive, or out of memory
+static int column_reader_open(ColumnReader *rd, const char *path) {
+    memset(rd, 0, sizeof(*rd));
+    rd->f = fopen(path, "rb");
+    if (!rd->f) return 0;
+    if (fread(&rd->meta, sizeof(rd->meta), 1, rd->f) != 1 ||
+        memcmp(rd->meta.magic, COLUMN_ARCHIVE_MAGIC, sizeof(rd->meta.magic)) != 0 ||
+        rd->meta.block_rows == 0 || rd->meta.block_rows > COLUMN_BLOCK_ROWS) {
+        column_reader_close(rd);
+        return 0;
+    }
+    rd->rows = malloc(sizeof(Record) * COLUMN_BLOCK_ROWS);
+    rd->seg = malloc(COLUMN_SEGMENT_MAX);
+    rd->num = malloc(sizeof(uint32_t) * COLUMN_BLOCK_ROWS);
+    rd->digits = malloc(sizeof(uint32_t) * COLUMN_BLOCK_ROWS);
+    rd->codes = malloc(sizeof(uint32_t) * COLUMN_BLOCK_ROWS);
+    rd->dict = malloc(sizeof(char *) * COLUMN_BLOCK_ROWS);
+    rd->entry_hit = malloc(COLUMN_BLOCK_ROWS);
+    if (!rd->rows || !rd->seg || !rd->num || !rd->digits || !rd->codes || !rd->dict || !rd->entry_hit) {
+        column_reader_close(rd);
+        return 0;
+    }
+    return 1;
+}
+
+// the meta of the archive at path; 0 if it is missing or not an archive
+int column_archive_read_meta(const char *path, ColumnArchiveMeta *out) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    int ok = fread(out, sizeof(*out), 1, f) == 1 && memcmp(out->magic, COLUMN_ARCHIVE_MAGIC, sizeof(out->magic)) == 0;
+    fclose(f);
+    return ok;
+}
+
+// size and bits per row of the archive and each column, against the CSV it was packed from
+void print_column_stats(const char *path, const ColumnArchiveMeta *m, FILE *out) {
+    static const char *names[] = {"InspectionID", "CarRegNumber", "OwnerName", "InspectionDate"};
+    struct stat st;
+    unsigned long long size = stat(path, &st) == 0 ? (unsigned long long)st.st_size : 0;
+    double rows = m->rows ? (double)m->rows : 1;
+    fprintf(out, "%s: %llu rows in %u blocks of up to %u\n", path, (unsigned long long)m->rows, m->blocks,
+            m->block_rows);
+    fprintf(out, "%-16s %14s %12s\n", "", "bytes", "bits/row");
+    fprintf(out, "%-16s %14llu %12.1f\n", "CSV", (unsigned long long)m->source_bytes, m->source_bytes * 8.0 / rows);
+    fprintf(out, "%-16s %14llu %12.1f   (%.1fx smaller)\n", "archive", size, size * 8.0 / rows,
+            size ? (double)m->source_bytes / (double)size : 0.0);
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        fprintf(out, "  %-14s %14llu %12.1f\n", names[c], (unsigned long long)m->column_bytes[c],
+                m->column_bytes[c] * 8.0 / rows);
+    }
+}
+
+// read segment c of the block whose segments start at seg_at into rd->seg
+static int column_read(ColumnReader *rd, const ColumnBlockHeader *h, const unsigned long long *seg_at, int c,
+                       ColumnScanStats *st) {
+    st->segments_read++;
+    st->bytes_read += h->bytes[c];
+    return file_seek(rd->f, seg_at[c]) == 0 && fread(rd->seg, 1, h->bytes[c], rd->f) == h->bytes[c];
+}
+
+// rows of the archive at path dated from..to (date_day_numbers, inclusive: 0..UINT32_MAX
+// takes undated rows too) and, with a key, whose InspectionID or CarRegNumber is key in
+// any case. The date and key are tested on the encoded columns; the columns in `columns`
+// (bit QUERY_FIELD_x each) are decoded only for blocks with a match, and fields outside
+// them reach emit empty. A key that matches an InspectionID ends the scan after its
+// block. Returns the number of rows emitted, -1 if the file is missing or damaged
+long column_archive_scan(const char *path, unsigned columns, uint32_t from, uint32_t to, const char *key,
+                         RecordFn emit, void *ctx, ColumnScanStats *st) {
+    ColumnReader rd;
+    ColumnScanStats local;
+    if (!st) st = &local;
+    memset(st, 0, sizeof(*st));
+    if (!column_reader_open(&rd, path)) return -1;
+    int by_date = from > 0 || to < UINT32_MAX;
+    unsigned long long at = sizeof(rd.meta);
+    unsigned char match[COLUMN_BLOCK_ROWS], hit[COLUMN_BLOCK_ROWS];
+    long found = 0;
+    int ok = 1, done = 0;
+    for (uint32_t b = 0; ok && !done && b < rd.meta.blocks; ++b) {
+        ColumnBlockHeader h;
+        ok = file_seek(rd.f, at) == 0 && fread(&h, sizeof(h), 1, rd.f) == 1 && h.rows <= rd.meta.block_rows;
+        if (!ok) break;
+        unsigned long long seg_at[COLUMN_COUNT], next = at + sizeof(h);
+        for (int c = 0; c < COLUMN_COUNT; ++c) {
+            seg_at[c] = next;
+            next += h.bytes[c];
+            ok = ok && h.bytes[c] <= COLUMN_SEGMENT_MAX;
+        }
+        at = next;
+        if (!ok) break;
+        if (h.min_day > to || h.max_day < from) {
+            st->blocks_skipped++;
+            continue;
+        }
+        st->blocks_read++;
+        int n = (int)h.rows, hits = 0;
+        memset(match, 1, (size_t)n);
+        if (by_date) {
+            ok = column_read(&rd, &h, seg_at, QUERY_FIELD_DATE, st) &&
+                 column_match_days(&rd, rd.seg, h.bytes[QUERY_FIELD_DATE], n, from, to, match);
+        }
+        if (ok && key) {
+            memset(hit, 0, (size_t)n);
+            ok = column_read(&rd, &h, seg_at, QUERY_FIELD_ID, st) &&
+                 column_match_key(&rd, QUERY_FIELD_ID, rd.seg, h.bytes[QUERY_FIELD_ID], n, key, hit);
+            for (int i = 0; ok && i < n; ++i) done |= match[i] && hit[i];
+            ok = ok && column_read(&rd, &h, seg_at, QUERY_FIELD_PLATE, st) &&
+                 column_match_key(&rd, QUERY_FIELD_PLATE, rd.seg, h.bytes[QUERY_FIELD_PLATE], n, key, hit);
+            for (int i = 0; i < n; ++i) match[i] &= hit[i];
+        }
+        for (int i = 0; i < n; ++i) hits += match[i];
+        // strings are built only for blocks with a match
+        for (int c = 0; ok && hits > 0 && c < COLUMN_COUNT; ++c) {
+            if (columns & (1u << c)) ok = column_read(&rd, &h, seg_at, c, st) && column_decode(&rd, c, rd.seg, h.bytes[c], n);
+        }
+        if (!ok) break;
+        for (int i = 0; i < n && hits > 0; ++i) {
+            if (!match[i]) continue;
+            Record *r = &rd.rows[i];
+            if (!(columns & (1u << QUERY_FIELD_ID))) r->inspectionID[0] = '\0';
+            if (!(columns & (1u << QUERY_FIELD_PLATE))) r->carReg[0] = '\0';
+            if (!(columns & (1u << QUERY_FIELD_OWNER))) r->owner[0] = '\0';
+            if (!(columns & (1u << QUERY_FIELD_DATE))) r->date[0] = '\0';
+            if (emit) emit(r, ctx);
+            found++;
+        }
+    }
+    column_reader_close(&rd);
+    return ok ? found : -1;
+}
+
+/* ---------- Snapshot store (MVCC, epoch-based reclamation) ---------- */
+
+static int mvcc_chunks_for(int rows) {
+    return (rows + MVCC_CHUNK_ROWS - 1) / MVCC_CHUNK_ROWS;
+}
+
+static int mvcc_pages_for(int rows) {
+    return (mvcc_chunks_for(rows) + MVCC_PAGE_CHUNKS - 1) / MVCC_PAGE_CHUNKS;
+}
+
+static MvccChunk *mvcc_chunk_at(const MvccVersion *v, int c) {
+    return v->pages[c / MVCC_PAGE_CHUNKS]->chunks[c % MVCC_PAGE_CHUNKS];
+}
+
+// write r to slot at of chunk, key slots included
+static void mvcc_set_row(MvccChunk *chunk, int at, const Record *r) {
+    chunk->rows[at] = *r;
+    key_slot_set(&chunk->id_keys[at], r->inspectionID);
+    key_slot_set(&chunk->reg_keys[at], r->carReg);
+}
+
+void mvcc_init(MvccStore *s) {
+    memset(s, 0, sizeof(*s));
+    MvccVersion *v = calloc(1, sizeof(MvccVersion));
+    if (v) v->serial = 1;
+    atomic_init(&s->current, v);
+    atomic_init(&s->epoch, 1);
+    for (int i = 0; i < MVCC_MAX_READERS; ++i) {
+        atomic_init(&s->pinned[i], 0);
+        atomic_init(&s->claimed[i], 0);
+    }
+    pthread_mutex_init(&s->write_lock, NULL);
+}
+
+// a reader slot for the calling thread; -1 when all MVCC_MAX_READERS are taken
+int mvcc_register(MvccStore *s) {
+    for (int i = 0; i < MVCC_MAX_READERS; ++i) {
+        int free_slot = 0;
+        if (atomic_compare_exchange_strong(&s->claimed[i], &free_slot, 1)) return i;
+    }
+    return -1;
+}
+
+void mvcc_unregister(MvccStore *s, int slot) {
+    atomic_store(&s->pinned[slot], 0);
+    atomic_store(&s->claimed[slot], 0);
+}
+
+// the current version, readable until mvcc_unpin; the slot's epoch is published before
+// the version is loaded, so a writer either sees the pin or the reader sees its publish
+const MvccVersion *mvcc_pin(MvccStore *s, int slot) {
+    atomic_store(&s->pinned[slot], atomic_load(&s->epoch));
+    return atomic_load(&s->current);
+}
+
+void mvcc_unpin(MvccStore *s, int slot) {
+    atomic_store(&s->pinned[slot], 0);
+}
+
+int mvcc_count(const MvccVersion *v) {
+    return v->count;
+}
+
+uint64_t mvcc_serial(const MvccVersion *v) {
+    return v->serial;
+}
+
+const Record *mvcc_row(const MvccVersion *v, int i) {
+    return &mvcc_chunk_at(v, i / MVCC_CHUNK_ROWS)->rows[i % MVCC_CHUNK_ROWS];
+}
+
+// row i and the rows after it in its chunk, *n of them contiguous; scans walk a version
+// a chunk at a time with this
+const Record *mvcc_rows_at(const MvccVersion *v, int i, int *n) {
+    int left = MVCC_CHUNK_ROWS - i % MVCC_CHUNK_ROWS;
+    *n = v->count - i < left ? v->count - i : left;
+    return mvcc_row(v, i);
+}
+
+// queue ptr to be freed once no reader can reach it; out of memory it leaks rather than
+// risk a reader
+static void mvcc_retire(MvccStore *s, void *ptr, size_t bytes, uint64_t epoch) {
+    MvccRetired *r = malloc(sizeof(MvccRetired));
+    if (!r) return;
+    r->ptr = ptr;
+    r->bytes = bytes;
+    r->epoch = epoch;
+    r->next = NULL;
+    if (s->retired_tail) s->retired_tail->next = r;
+    else s->retired = r;
+    s->retired_tail = r;
+    s->retired_pending++;
+    s->retired_bytes += bytes;
+}
+
+// free what every pinned reader has moved past; caller holds write_lock. Returns the number freed
+static long mvcc_reclaim_locked(MvccStore *s) {
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < MVCC_MAX_READERS; ++i) {
+        uint64_t e = atomic_load(&s->pinned[i]);
+        if (e && e < oldest) oldest = e;
+    }
+    long freed = 0;
+    while (s->retired && s->retired->epoch <= oldest) {
+        MvccRetired *r = s->retired;
+        s->retired = r->next;
+        s->freed_bytes += r->bytes;
+        free(r->ptr);
+        free(r);
+        s->retired_pending--;
+        freed++;
+    }
+    if (!s->retired) s->retired_tail = NULL;
+    return freed;
+}
+
+long mvcc_reclaim(MvccStore *s) {
+    pthread_mutex_lock(&s->write_lock);
+    long freed = mvcc_reclaim_locked(s);
+    pthread_mutex_unlock(&s->write_lock);
+    return freed;
+}
+
+// note a block the write replaces; 0 when out of memory
+static int mvcc_note_dead(MvccStore *s, void *ptr, size_t bytes) {
+    if (s->ndead == s->dead_cap) {
+        int cap = s->dead_cap ? s->dead_cap * 2 : 16;
+        MvccBlock *d = realloc(s->dead, sizeof(MvccBlock) * (size_t)cap);
+        if (!d) return 0;
+        s->dead = d;
+        s->dead_cap = cap;
+    }
+    s->dead[s->ndead].ptr = ptr;
+    s->dead[s->ndead++].bytes = bytes;
+    return 1;
+}
+
+// note a block the write allocated, to be freed again if the write fails; 0 when out of memory
+static int mvcc_note_fresh(MvccStore *s, void *p) {
+    if (s->nfresh == s->fresh_cap) {
+        int cap = s->fresh_cap ? s->fresh_cap * 2 : 16;
+        void **f = realloc(s->fresh, sizeof(void *) * (size_t)cap);
+        if (!f) return 0;
+        s->fresh = f;
+        s->fresh_cap = cap;
+    }
+    s->fresh[s->nfresh++] = p;
+    return 1;
+}
+
+// a block for the write, freed again if the write fails
+static void *mvcc_alloc(MvccStore *s, size_t bytes) {
+    void *p = malloc(bytes);
+    if (p && !mvcc_note_fresh(s, p)) {
+        free(p);
+        p = NULL;
+    }
+    return p;
+}
+
+// the next version after base, sharing base's pages (its directory resized to npages, new
+// entries empty); NULL when out of memory
+static MvccVersion *mvcc_write_begin(MvccStore *s, const MvccVersion *base, int npages) {
+    MvccVersion *v = mvcc_alloc(s, sizeof(MvccVersion));
+    if (!v) return NULL;
+    v->pages = NULL;
+    if (npages && !(v->pages = mvcc_alloc(s, sizeof(MvccPage *) * (size_t)npages))) return NULL;
+    int keep = npages < base->npages ? npages : base->npages;
+    if (keep > 0) memcpy(v->pages, base->pages, sizeof(MvccPage *) * (size_t)keep);
+    for (int p = keep; p < npages; ++p) v->pages[p] = NULL;
+    v->npages = npages;
+    v->count = base->count;
+    v->serial = base->serial + 1;
+    v->filter = base->filter;
+    return v;
+}
+
+// page p of v, made v's own: copied from base's the first time, or empty past its end
+static MvccPage *mvcc_own_page(MvccStore *s, MvccVersion *v, const MvccVersion *base, int p) {
+    MvccPage *shared = p < base->npages ? base->pages[p] : NULL;
+    if (v->pages[p] && v->pages[p] != shared) return v->pages[p];
+    MvccPage *page = mvcc_alloc(s, sizeof(MvccPage));
+    if (!page || (shared && !mvcc_note_dead(s, shared, sizeof(MvccPage)))) return NULL;
+    if (shared) memcpy(page, shared, sizeof(MvccPage));
+    else memset(page, 0, sizeof(MvccPage));
+    v->pages[p] = page;
+    return page;
+}
+
+// chunk c of v, made v's own: copied from base's the first time, or uninitialised past
+// base's last chunk
+static MvccChunk *mvcc_own_chunk(MvccStore *s, MvccVersion *v, const MvccVersion *base, int c) {
+    MvccPage *page = mvcc_own_page(s, v, base, c / MVCC_PAGE_CHUNKS);
+    if (!page) return NULL;
+    MvccChunk *shared = c < mvcc_chunks_for(base->count) ? mvcc_chunk_at(base, c) : NULL;
+    MvccChunk **slot = &page->chunks[c % MVCC_PAGE_CHUNKS];
+    if (*slot && *slot != shared) return *slot;
+    MvccChunk *chunk = mvcc_alloc(s, sizeof(MvccChunk));
+    if (!chunk || (shared && !mvcc_note_dead(s, shared, sizeof(MvccChunk)))) return NULL;
+    if (shared) {
+        memcpy(chunk, shared, sizeof(MvccChunk));
+        s->chunks_copied++;
+    }
+    *slot = chunk;
+    return chunk;
+}
+
+// give v a key filter built from its rows, with the store's headroom for adds, retiring
+// the one it shared; none when filters are off or there is no room for one. 0 when out
+// of memory for the write's bookkeeping
+static int mvcc_build_filter(MvccStore *s, MvccVersion *v) {
+    KeyFilter *old = v->filter;
+    if (old && (!mvcc_note_dead(s, old, sizeof(KeyFilter)) || !mvcc_note_dead(s, old->blocks, key_filter_bytes(old)))) {
+        return 0;
+    }
+    v->filter = NULL;
+    KeyFilterConfig *c = key_filter_config();
+    uint64_t keys = 2 * (uint64_t)v->count;
+    KeyFilter *f = c->enabled ? malloc(sizeof(KeyFilter)) : NULL;
+    if (!f) return 1;
+    key_filter_init(f);
+    if (!key_filter_reset(f, keys + keys / KEY_FILTER_HEADROOM + KEY_FILTER_MIN_KEYS, c->bits_per_key)) {
+        free(f);
+        return 1;
+    }
+    if (!mvcc_note_fresh(s, f)) {
+        key_filter_free(f);
+        free(f);
+        return 0;
+    }
+    if (!mvcc_note_fresh(s, f->blocks)) {
+        free(f->blocks);
+        return 0;
+    }
+    for (int i = 0; i < v->count; ++i) {
+        const Record *r = mvcc_row(v, i);
+        key_filter_add(f, r->inspectionID);
+        key_filter_add(f, r->carReg);
+    }
+    atomic_fetch_add(&c->rebuilds, 1);
+    v->filter = f;
+    return 1;
+}
+
+// r was just written to v: its keys go into v's filter, in place while it has room
+// (readers of older versions may then see them, which is only a false positive),
+// otherwise by a rebuild
+static int mvcc_filter_add(MvccStore *s, MvccVersion *v, const Record *r) {
+    KeyFilter *f = v->filter;
+    if (!f) return 1;
+    if (f->keys + 2 > f->capacity) return mvcc_build_filter(s, v);
+    key_filter_add(f, r->inspectionID);
+    key_filter_add(f, r->carReg);
+    return 1;
+}
+
+// publish v in place of old and retire what it replaced (ok), or free what the write
+// allocated; releases write_lock and returns ok
+static int mvcc_write_end(MvccStore *s, MvccVersion *old, MvccVersion *v, int ok) {
+    ok = ok && mvcc_note_dead(s, old, sizeof(MvccVersion)) &&
+         (!old->npages || mvcc_note_dead(s, old->pages, sizeof(MvccPage *) * (size_t)old->npages));
+    if (!ok) {
+        for (int i = 0; i < s->nfresh; ++i) free(s->fresh[i]);
+    } else {
+        atomic_store(&s->current, v);
+        uint64_t epoch = atomic_fetch_add(&s->epoch, 1) + 1;
+        for (int i = 0; i < s->ndead; ++i) mvcc_retire(s, s->dead[i].ptr, s->dead[i].bytes, epoch);
+        s->versions++;
+        mvcc_reclaim_locked(s);
+    }
+    s->ndead = s->nfresh = 0;
+    pthread_mutex_unlock(&s->write_lock);
+    return ok;
+}
+
+// replace the rows with rows[0..n); 1 on success
+int mvcc_load(MvccStore *s, const Record *rows, int n) {
+    pthread_mutex_lock(&s->write_lock);
+    MvccVersion *old = atomic_load(&s->current);
+    MvccVersion empty = {NULL, 0, 0, old->serial, old->filter};
+    MvccVersion *v = mvcc_write_begin(s, &empty, mvcc_pages_for(n));
+    int ok = v != NULL;
+    for (int c = 0; ok && c < mvcc_chunks_for(old->count); ++c) ok = mvcc_note_dead(s, mvcc_chunk_at(old, c), sizeof(MvccChunk));
+    for (int p = 0; ok && p < old->npages; ++p) ok = mvcc_note_dead(s, old->pages[p], sizeof(MvccPage));
+    for (int c = 0; ok && c < mvcc_chunks_for(n); ++c) {
+        MvccChunk *chunk = mvcc_own_chunk(s, v, &empty, c);
+        int from = c * MVCC_CHUNK_ROWS, k = n - from < MVCC_CHUNK_ROWS ? n - from : MVCC_CHUNK_ROWS;
+        if (!(ok = chunk != NULL)) break;
+        for (int i = 0; i < k; ++i) mvcc_set_row(chunk, i, &rows[from + i]);
+    }
+    if (ok) v->count = n;
+    ok = ok && mvcc_build_filter(s, v);
+    return mvcc_write_end(s, old, v, ok);
+}
+
+// add r after the last row. The free slot of a partly filled last chunk is written in
+// place: it is past the end of every version sharing that chunk, since rows only move
+// down in mvcc_remove, which copies the chunks it touches. 1 on success
+int mvcc_append(MvccStore *s, const Record *r) {
+    pthread_mutex_lock(&s->write_lock);
+    MvccVersion *old = atomic_load(&s->current);
+    MvccVersion *v = old->count < INT_MAX ? mvcc_write_begin(s, old, mvcc_pages_for(old->count + 1)) : NULL;
+    int c = old->count / MVCC_CHUNK_ROWS, at = old->count % MVCC_CHUNK_ROWS;
+    MvccChunk *chunk = !v ? NULL : at ? mvcc_chunk_at(old, c) : mvcc_own_chunk(s, v, old, c);
+    if (chunk) {
+        mvcc_set_row(chunk, at, r);
+        v->count++;
+    }
+    return mvcc_write_end(s, old, v, chunk && mvcc_filter_add(s, v, r));
+}
+
+// replace row i with r, copying its chunk and page; 1 on success
+int mvcc_update(MvccStore *s, int i, const Record *r) {
+    pthread_mutex_lock(&s->write_lock);
+    MvccVersion *old = atomic_load(&s->current);
+    MvccVersion *v = i >= 0 && i < old->count ? mvcc_write_begin(s, old, old->npages) : NULL;
+    MvccChunk *chunk = v ? mvcc_own_chunk(s, v, old, i / MVCC_CHUNK_ROWS) : NULL;
+    if (chunk) mvcc_set_row(chunk, i % MVCC_CHUNK_ROWS, r);
+    return mvcc_write_end(s, old, v, chunk && mvcc_filter_add(s, v, r)); // the old keys stay: false positives
+}
+
+// remove row i, keeping the order of the rest: its chunk and every later one are copied
+// with the rows shifted down one; 1 on success
+int mvcc_remove(MvccStore *s, int i) {
+    pthread_mutex_lock(&s->write_lock);
+    MvccVersion *old = atomic_load(&s->current);
+    int n = old->count - 1;
+    MvccVersion *v = i >= 0 && i <= n ? mvcc_write_begin(s, old, mvcc_pages_for(n)) : NULL;
+    int ok = v != NULL, kept = mvcc_chunks_for(n), had = mvcc_chunks_for(old->count);
+    for (int c = i / MVCC_CHUNK_ROWS; ok && c < kept; ++c) {
+        MvccChunk *chunk = mvcc_own_chunk(s, v, old, c);
+        if (!(ok = chunk != NULL)) break;
+        int from = c == i / MVCC_CHUNK_ROWS ? i % MVCC_CHUNK_ROWS : 0;
+        size_t tail = (size_t)(MVCC_CHUNK_ROWS - from - 1);
+        memmove(chunk->rows + from, chunk->rows + from + 1, sizeof(Record) * tail);
+        memmove(chunk->id_keys + from, chunk->id_keys + from + 1, sizeof(KeySlot) * tail);
+        memmove(chunk->reg_keys + from, chunk->reg_keys + from + 1, sizeof(KeySlot) * tail);
+        if (c + 1 < had) {
+            const MvccChunk *next = mvcc_chunk_at(old, c + 1);
+            chunk->rows[MVCC_CHUNK_ROWS - 1] = next->rows[0];
+            chunk->id_keys[MVCC_CHUNK_ROWS - 1] = next->id_keys[0];
+            chunk->reg_keys[MVCC_CHUNK_ROWS - 1] = next->reg_keys[0];
+        }
+    }
+    // a chunk, and a page, left empty at the end are dropped; a page that stays loses the
+    // chunk's pointer, since appends take an owned non-empty slot as already copied
+    if (ok && kept < had) ok = mvcc_note_dead(s, mvcc_chunk_at(old, kept), sizeof(MvccChunk));
+    if (ok && kept < had && kept / MVCC_PAGE_CHUNKS < v->npages) {
+        MvccPage *page = mvcc_own_page(s, v, old, kept / MVCC_PAGE_CHUNKS);
+        if ((ok = page != NULL)) page->chunks[kept % MVCC_PAGE_CHUNKS] = NULL;
+    }
+    if (ok && v->npages < old->npages) ok = mvcc_note_dead(s, old->pages[v->npages], sizeof(MvccPage));
+    if (ok) v->count = n;
+    return mvcc_write_end(s, old, v, ok); // the removed keys stay in the filter: false positives
+}
+
+// first row in [begin, end) of v whose InspectionID or CarRegNumber equals q's key, or
+// -1: each chunk's key columns go through the compare kernel, and candidates of long
+// keys are confirmed with strcasecmp
+static int mvcc_find_key(const MvccVersion *v, int begin, int end, const KeyQuery *q) {
+    while (begin < end) {
+        int base = begin - begin % MVCC_CHUNK_ROWS;
+        const MvccChunk *chunk = mvcc_chunk_at(v, base / MVCC_CHUNK_ROWS);
+        int stop = end - base < MVCC_CHUNK_ROWS ? end - base : MVCC_CHUNK_ROWS;
+        for (int i = begin - base; (i = key_column_find(chunk->id_keys, chunk->reg_keys, i, stop, q)) >= 0; ++i) {
+            if (!q->verify || strcasecmp(chunk->rows[i].inspectionID, q->key) == 0 ||
+                strcasecmp(chunk->rows[i].carReg, q->key) == 0) {
+                return base + i;
+            }
+        }
+        begin = base + stop;
+    }
+    return -1;
+}
+
+typedef struct {
+    const MvccVersion *v;
+    KeyQuery q;
+} MvccCollectCtx;
+
+static void mvcc_collect_chunk(int begin, int end, void *ctx, void *out) {
+    MvccCollectCtx *c = ctx;
+    IndexList *list = out;
+    int i = begin;
+    while ((i = mvcc_find_key(c->v, i, end, &c->q)) >= 0) {
+        if (!index_list_push(list, i++)) return;
+    }
+}
+
+// every row of v matching key, in order, into an array from arena, as store_collect_key
+// does for a store: the filter first, then the key columns; returns count or -1 (out of memory)
+int mvcc_collect_key(const MvccVersion *v, const char *key, Arena *arena, int **out_idx) {
+    *out_idx = NULL;
+    if (!key_filter_check(v->filter, key)) return 0;
+    MvccCollectCtx c;
+    key_query_init(&c.q, key);
+    c.v = v;
+    ThreadPool *pool = v->count > PARALLEL_SCAN_THRESHOLD ? scan_pool() : NULL;
+    int chunks = scan_chunk_count(pool, v->count);
+    if (chunks == 0) return 0;
+    IndexList *lists = index_lists_alloc(arena, chunks);
+    if (!lists) return -1;
+    parallel_scan(pool, v->count, mvcc_collect_chunk, &c, lists, sizeof(IndexList));
+    int n = merge_index_lists(lists, chunks, arena, out_idx);
+    if (n == 0) key_filter_missed(v->filter);
+    return n;
+}
+
+// free everything; no reader may be pinned
+void mvcc_free(MvccStore *s) {
+    MvccVersion *v = atomic_load(&s->current);
+    for (int c = 0; v && c < mvcc_chunks_for(v->count); ++c) free(mvcc_chunk_at(v, c));
+    for (int p = 0; v && p < v->npages; ++p) free(v->pages[p]);
+    if (v && v->filter) {
+        key_filter_free(v->filter);
+        free(v->filter);
+    }
+    if (v) free(v->pages);
+    free(v);
+    while (s->retired) {
+        MvccRetired *r = s->retired;
+        s->retired = r->next;
+        free(r->ptr);
+        free(r);
+    }
+    free(s->dead);
+    free(s->fresh);
+    pthread_mutex_destroy(&s->write_lock);
+    memset(s, 0, sizeof(*s));
+}
+
+/* ---------- Write-behind persistence ---------- */
+
+// pthread_cond_timedwait with a relative timeout
+static void cond_wait_ms(pthread_cond_t *cond, pthread_mutex_t *lock, double ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long long ns = ts.tv_nsec + (long long)(ms * 1e6);
+    ts.tv_sec += (time_t)(ns / 1000000000LL);
+    ts.tv_nsec = (long)(ns % 1000000000LL);
+    pthread_cond_timedwait(cond, lock, &ts);
+}
+
+static int persist_apply(RecordStore *store, const PersistOp *op) {
+    switch (op->kind) {
+        case PERSIST_ADD:
+            return store_append(store, &op->rec);
+        case PERSIST_SET:
+            return store_set(store, op->row, &op->rec);
+        case PERSIST_REMOVE:
+            store_remove(store, op->row);
+            return 1;
+    }
+    return 0;
+}
+
+static void *write_behind_main(void *arg) {
+    WriteBehind *wb = arg;
+    PersistOp *spare = NULL;
+    int spare_cap = 0;
+    int unwritten = 0; // shadow has changes the file lacks (last write failed)
+    int moved = 0; // ...and some of them moved rows, so the index needs a rebuild
+    pthread_mutex_lock(&wb->lock);
+    while (1) {
+        // sleep until changes arrive, an fsync (or a retry) falls due, or stop
+        while (!wb->nops && !wb->stop) {
+            if (!wb->dirty) {
+                pthread_cond_wait(&wb->wake, &wb->lock);
+                continue;
+            }
+            double interval = wb->fsync_ms > 0 ? wb->fsync_ms : WRITE_BEHIND_RETRY_MS;
+            double left = wb->dirty_since + interval - now_ms();
+            if (left <= 0) break;
+            cond_wait_ms(&wb->wake, &wb->lock, left);
+        }
+        // let the rest of a burst arrive so it goes out in one write
+        double first = now_ms();
+        while (wb->nops && !wb->stop) {
+            double t = now_ms();
+            double quiet = t - wb->last_push_ms;
+            if (quiet >= WRITE_BEHIND_COALESCE_MS || t - first >= WRITE_BEHIND_MAX_DELAY_MS) break;
+            cond_wait_ms(&wb->wake, &wb->lock, WRITE_BEHIND_COALESCE_MS - quiet);
+        }
+
+        PersistOp *ops = wb->ops;
+        int n = wb->nops, cap = wb->cap, stopping = wb->stop;
+        wb->ops = spare;
+        wb->cap = spare_cap;
+        wb->nops = 0;
+        spare = ops;
+        spare_cap = cap;
+        wb->busy = n;
+        if (n && !wb->dirty) {
+            wb->dirty = 1;
+            wb->dirty_since = now_ms();
+        }
+        int dirty = wb->dirty;
+        int sync_due = stopping || wb->fsync_ms <= 0 || now_ms() - wb->dirty_since >= wb->fsync_ms;
+        pthread_mutex_unlock(&wb->lock);
+
+        int lost = 0;
+        for (int i = 0; i < n; ++i) {
+            lost += !persist_apply(&wb->shadow, &ops[i]);
+            moved |= ops[i].kind != PERSIST_ADD;
+        }
+        // every new file is on disk before it replaces the old one, so a crash never
+        // leaves less than the last durable state; the rename is flushed when an fsync is due
+        int wrote = 0, flush = dirty && sync_due;
+        if (n || unwritten) {
+            wrote = store_save_path(&wb->shadow, wb->path, flush ? SAVE_SYNC_ALL : SAVE_SYNC_DATA);
+            unwritten = !wrote;
+        }
+        if (wrote) {
+            disk_index_refresh(wb->path, moved);
+            moved = 0;
+        }
+        int synced = flush && !unwritten && (wrote || dir_sync(wb->path));
+
+        pthread_mutex_lock(&wb->lock);
+        wb->writes += wrote;
+        wb->ops_written += n;
+        wb->failures += lost + (unwritten || (flush && !synced));
+        if (synced) {
+            wb->dirty = 0;
+            wb->last_durable_ms = now_ms();
+            wb->fsyncs++;
+        } else if (unwritten || flush) {
+            wb->dirty_since = now_ms(); // failed: retry after another interval
+        }
+        wb->busy = 0;
+        pthread_cond_broadcast(&wb->idle);
+        if (stopping && !wb->nops) break;
+    }
+    pthread_mutex_unlock(&wb->lock);
+    free(spare);
+    return NULL;
+}
+
+// start persisting to path from a copy of store (which must match the file); 0 on failure
+int write_behind_start(WriteBehind *wb, const RecordStore *store, const char *path, int fsync_ms) {
+    memset(wb, 0, sizeof(*wb));
+    store_init(&wb->shadow);
+    wb->path = path;
+    wb->fsync_ms = fsync_ms;
+    Record r;
+    int ok = store_reserve(&wb->shadow, store->count);
+    for (int i = 0; ok && i < store->count; ++i) {
+        store_get(store, i, &r);
+        ok = store_append(&wb->shadow, &r);
+    }
+    if (!ok) {
+        store_free(&wb->shadow);
+        return 0;
+    }
+    pthread_mutex_init(&wb->lock, NULL);
+    pthread_cond_init(&wb->wake, NULL);
+    pthread_cond_init(&wb->idle, NULL);
+    if (pthread_create(&wb->thread, NULL, write_behind_main, wb) != 0) {
+        pthread_cond_destroy(&wb->idle);
+        pthread_cond_destroy(&wb->wake);
+        pthread_mutex_destroy(&wb->lock);
+        store_free(&wb->shadow);
+        return 0;
+    }
+    wb->running = 1;
+    return 1;
+}
+
+// drain the queue, write and fsync what is left, join the thread; 0 if changes were lost
+int write_behind_stop(WriteBehind *wb) {
+    if (!wb->running) return 1;
+    pthread_mutex_lock(&wb->lock);
+    wb->stop = 1;
+    pthread_cond_signal(&wb->wake);
+    pthread_mutex_unlock(&wb->lock);
+    pthread_join(wb->thread, NULL);
+    wb->running = 0;
+    pthread_cond_destroy(&wb->idle);
+    pthread_cond_destroy(&wb->wake);
+    pthread_mutex_destroy(&wb->lock);
+    free(wb->ops);
+    wb->ops = NULL;
+    wb->nops = wb->cap = 0;
+    store_free(&wb->shadow);
+    return !wb->dirty;
+}
+
+// queue one change (row as in the caller's store before/after the change); 0 when out of memory
+int write_behind_push(WriteBehind *wb, int kind, int row, const Record *r) {
+    pthread_mutex_lock(&wb->lock);
+    if (wb->nops == wb->cap) {
+        int newcap = wb->cap ? wb->cap * 2 : WRITE_BEHIND_INITIAL_OPS;
+        PersistOp *p = realloc(wb->ops, sizeof(PersistOp) * (size_t)newcap);
+        if (!p) {
+            pthread_mutex_unlock(&wb->lock);
+            return 0;
+        }
+        wb->ops = p;
+        wb->cap = newcap;
+    }
+    PersistOp *op = &wb->ops[wb->nops++];
+    op->kind = kind;
+    op->row = row;
+    if (r) op->rec = *r;
+    wb->last_push_ms = now_ms();
+    pthread_cond_signal(&wb->wake);
+    pthread_mutex_unlock(&wb->lock);
+    return 1;
+}
+
+// block until everything queued so far has been written (not necessarily fsynced)
+void write_behind_flush(WriteBehind *wb) {
+    if (!wb->running) return;
+    pthread_mutex_lock(&wb->lock);
+    while (wb->nops || wb->busy) pthread_cond_wait(&wb->idle, &wb->lock);
+    pthread_mutex_unlock(&wb->lock);
+}
+
+void write_behind_stats(WriteBehind *wb, WriteBehindStats *out) {
+    memset(out, 0, sizeof(*out));
+    if (!wb->running) return;
+    pthread_mutex_lock(&wb->lock);
+    out->running = 1;
+    out->fsync_ms = wb->fsync_ms;
+    out->depth = wb->nops + wb->busy;
+    out->dirty = wb->dirty;
+    out->since_durable_ms = wb->last_durable_ms > 0 ? now_ms() - wb->last_durable_ms : -1;
+    out->writes = wb->writes;
+    out->ops_written = wb->ops_written;
+    out->fsyncs = wb->fsyncs;
+    out->failures = wb->failures;
+    pthread_mutex_unlock(&wb->lock);
+}
+
+/* ---------- Group commit (durable appends) ---------- */
+
+int group_commit_init(GroupCommit *gc, const char *path, int max_batch, int window_us) {
+    memset(gc, 0, sizeof(*gc));
+    if (max_batch < 1) max_batch = 1;
+    if (max_batch > GROUP_COMMIT_MAX_BATCH) max_batch = GROUP_COMMIT_MAX_BATCH;
+    gc->tickets = malloc(sizeof(CommitTicket *) * (size_t)max_batch);
+    if (!gc->tickets) return 0;
+    gc->path = path;
+    gc->max_batch = max_batch;
+    gc->window_us = window_us;
+    pthread_mutex_init(&gc->lock, NULL);
+    pthread_cond_init(&gc->more, NULL);
+    pthread_cond_init(&gc->done, NULL);
+    gc->enabled = 1;
+    return 1;
+}
+
+// no caller may be inside group_commit_append
+void group_commit_free(GroupCommit *gc) {
+    if (!gc->enabled) return;
+    pthread_cond_destroy(&gc->done);
+    pthread_cond_destroy(&gc->more);
+    pthread_mutex_destroy(&gc->lock);
+    free(gc->buf);
+    free(gc->tickets);
+    gc->buf = NULL;
+    gc->tickets = NULL;
+    gc->enabled = 0;
+}
+
+// take the queued batch, write it with one fdatasync and wake its callers (lock held on entry and exit)
+static void group_commit_flush(GroupCommit *gc) {
+    char *buf = gc->buf;
+    size_t len = gc->len;
+    int n = gc->pending;
+    CommitTicket *batch[GROUP_COMMIT_MAX_BATCH];
+    memcpy(batch, gc->tickets, sizeof(CommitTicket *) * (size_t)n);
+    gc->buf = NULL;
+    gc->len = gc->cap = 0;
+    gc->pending = 0;
+    gc->flushing = 1;
+    pthread_mutex_unlock(&gc->lock);
+
+    unsigned long long start = 0;
+    double t0 = now_ms();
+    int ok = file_append_sync(gc->path, buf, len, &start);
+    if (ok && start == 0) ok = dir_sync(gc->path); // the batch created the file
+    double t1 = now_ms();
+    free(buf);
+
+    pthread_mutex_lock(&gc->lock);
+    for (int i = 0; i < n; ++i) {
+        batch[i]->ok = ok;
+        batch[i]->at = start + batch[i]->pos;
+        batch[i]->done = 1;
+    }
+    gc->flushing = 0;
+    gc->commits += n;
+    gc->batches++;
+    gc->failures += !ok;
+    gc->sync_ms += t1 - t0;
+    pthread_cond_broadcast(&gc->done);
+}
+
+// append one line durably; *at = its file offset. 0 when the write or fdatasync failed
+int group_commit_append(GroupCommit *gc, const char *line, size_t len, unsigned long long *at) {
+    CommitTicket t = {0, 0, 0, 0};
+    pthread_mutex_lock(&gc->lock);
+    // a full batch must go out before this line can join the next one
+    while (gc->pending == gc->max_batch) {
+        if (!gc->flushing) group_commit_flush(gc);
+        else pthread_cond_wait(&gc->done, &gc->lock);
+    }
+    if (gc->len + len > gc->cap) {
+        size_t newcap = gc->cap ? gc->cap : GROUP_COMMIT_INITIAL_BYTES;
+        while (newcap < gc->len + len) newcap *= 2;
+        char *p = realloc(gc->buf, newcap);
+        if (!p) {
+            pthread_mutex_unlock(&gc->lock);
+            return 0;
+        }
+        gc->buf = p;
+        gc->cap = newcap;
+    }
+    t.pos = gc->len;
+    memcpy(gc->buf + gc->len, line, len);
+    gc->len += len;
+    gc->tickets[gc->pending++] = &t;
+    pthread_cond_signal(&gc->more);
+
+    while (!t.done) {
+        if (gc->flushing) {
+            pthread_cond_wait(&gc->done, &gc->lock);
+            continue;
+        }
+        // lead the batch holding our line: give others window_us to join, then flush
+        double deadline = now_ms() + gc->window_us / 1000.0;
+        while (!gc->flushing && gc->pending < gc->max_batch) {
+            double left = deadline - now_ms();
+            if (left <= 0) break;
+            cond_wait_ms(&gc->more, &gc->lock, left);
+        }
+        if (!t.done && !gc->flushing) group_commit_flush(gc);
+    }
+    pthread_mutex_unlock(&gc->lock);
+    *at = t.at;
+    return t.ok;
+}
+
+/* ---------- Sorted views (LSD radix sort on packed keys) ---------- */
+
+// Stable LSD radix sort of vals[0..n) on bytes first_byte..7, one byte per pass.
+// Views pack (key << 32) | row, so sorting from byte 4 orders by key and leaves
+// ties in file order. All histograms come from one read, and a byte that is the
+// same in every value costs no pass. tmp must hold n values; the result is in vals.
+void radix_sort_u64(uint64_t *vals, uint64_t *tmp, int n, int first_byte) {
+    if (n < 2) return;
+    size_t hist[8][256];
+    memset(hist, 0, sizeof(hist));
+    for (int i = 0; i < n; ++i) {
+        uint64_t v = vals[i];
+        for (int b = first_byte; b < 8; ++b) hist[b][(v >> (8 * b)) & 0xFF]++;
+    }
+
+    uint64_t *src = vals, *dst = tmp;
+    for (int b = first_byte; b < 8; ++b) {
+        size_t *h = hist[b];
+        if (h[(src[0] >> (8 * b)) & 0xFF] == (size_t)n) continue;
+        size_t sum = 0;
+        for (int d = 0; d < 256; ++d) {
+            size_t c = h[d];
+            h[d] = sum;
+            sum += c;
+        }
+        for (int i = 0; i < n; ++i) dst[h[(src[i] >> (8 * b)) & 0xFF]++] = src[i];
+        uint64_t *t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != vals) memcpy(vals, src, sizeof(uint64_t) * n);
+}
+
+// Order-preserving squeeze of 64-bit keys into 32 bits: each byte position is
+// replaced by the rank of its value among the values that occur there, read as
+// one mixed-radix number. Returns 0 (keys untouched) if that needs more than 32 bits.
+static int compact_keys(uint64_t *keys, int n) {
+    unsigned char seen[8][256];
+    memset(seen, 0, sizeof(seen));
+    for (int i = 0; i < n; ++i) {
+        uint64_t k = keys[i];
+        for (int b = 0; b < 8; ++b) seen[b][(k >> (8 * b)) & 0xFF] = 1;
+    }
+    uint32_t digit[8][256];
+    uint64_t weight = 1;
+    for (int b = 0; b < 8; ++b) {
+        uint32_t count = 0;
+        for (int v = 0; v < 256; ++v) {
+            if (seen[b][v]) digit[b][v] = (uint32_t)(count++ * weight);
+        }
+        weight *= count;
+        if (weight > UINT32_MAX) return 0;
+    }
+    for (int i = 0; i < n; ++i) {
+        uint64_t k = keys[i];
+        uint32_t c = 0;
+        for (int b = 0; b < 8; ++b) c += digit[b][(k >> (8 * b)) & 0xFF];
+        keys[i] = c;
+    }
+    return 1;
+}
+
+// folded plate slot read big-endian, so integer order is the (case-insensitive) string order
+static uint64_t plate_sort_key(const KeySlot *k) {
+    uint64_t v = 0;
+    for (int i = 0; i < KEY_SLOT_LEN; ++i) v = (v << 8) | k->b[i];
+    return v;
+}
+
+typedef struct {
+    const char *name;
+    OwnerHandle handle;
+} OwnerName;
+
+// case-insensitive like the plate view; exact case only breaks ties
+static int owner_name_cmp(const void *a, const void *b) {
+    const char *x = ((const OwnerName *)a)->name, *y = ((const OwnerName *)b)->name;
+    int c = strcasecmp(x, y);
+    return c ? c : strcmp(x, y);
+}
+
+// rank[h] = position of owner h in alphabetical order; malloc'd, NULL when out of memory
+static uint32_t *owner_ranks(const OwnerPool *pool) {
+    uint32_t *rank = malloc(sizeof(uint32_t) * (pool->count ? pool->count : 1));
+    OwnerName *names = malloc(sizeof(OwnerName) * (pool->count ? pool->count : 1));
+    if (!rank || !names) {
+        free(rank);
+        free(names);
+        return NULL;
+    }
+    for (OwnerHandle h = 0; h < pool->count; ++h) {
+        names[h].name = owner_str(pool, h);
+        names[h].handle = h;
+    }
+    qsort(names, pool->count, sizeof(OwnerName), owner_name_cmp);
+    for (uint32_t i = 0; i < pool->count; ++i) rank[names[i].handle] = i;
+    free(names);
+    return rank;
+}
+
+// (key, row) pairs: key first, row breaks ties so the order is stable
+static int key_row_cmp(const void *a, const void *b) {
+    const uint64_t *x = a, *y = b;
+    if (x[0] != y[0]) return x[0] < y[0] ? -1 : 1;
+    return (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+// plates that do not squeeze into 32 bits: comparison sort on (key, row) pairs
+static int sort_wide_keys(const uint64_t *keys, size_t n, int *perm) {
+    uint64_t (*pairs)[2] = malloc(sizeof(*pairs) * (n ? n : 1));
+    if (!pairs) return 0;
+    for (size_t i = 0; i < n; ++i) {
+        pairs[i][0] = keys[i];
+        pairs[i][1] = i;
+    }
+    qsort(pairs, n, sizeof(*pairs), key_row_cmp);
+    for (size_t i = 0; i < n; ++i) perm[i] = (int)pairs[i][1];
+    free(pairs);
+    return 1;
+}
+
+// scratch for view builds, kept by the store so rebuilds after an edit reuse it
+static uint64_t *store_sort_scratch(RecordStore *store, int n) {
+    size_t need = 2 * (size_t)(n ? n : 1);
+    if (need > store->sort_scratch_cap) {
+        uint64_t *p = realloc(store->sort_scratch, sizeof(uint64_t) * need);
+        if (!p) return NULL;
+        store->sort_scratch = p;
+        store->sort_scratch_cap = need;
+    }
+    return store->sort_scratch;
+}
+
+static int store_build_view(RecordStore *store, int field) {
+    int n = store->count;
+    SortView *v = &store->views[field];
+    size_t cells = n ? (size_t)n : 1;
+    int *perm = realloc(v->perm, sizeof(int) * cells);
+    if (!perm) return 0;
+    v->perm = perm;
+    uint64_t *vals = store_sort_scratch(store, n);
+    if (!vals) return 0;
+    uint64_t *tmp = vals + cells;
+
+    if (field == SORT_BY_DATE) {
+        for (int i = 0; i < n; ++i) vals[i] = (uint64_t)store->day_keys[i] << 32 | (uint32_t)i;
+    } else if (field == SORT_BY_OWNER) {
+        uint32_t *owner_rank = owner_ranks(&store->owners);
+        if (!owner_rank) return 0;
+        for (int i = 0; i < n; ++i) vals[i] = (uint64_t)owner_rank[store->rows[i].owner] << 32 | (uint32_t)i;
+        free(owner_rank);
+    } else {
+        for (int i = 0; i < n; ++i) vals[i] = plate_sort_key(&store->reg_keys[i]);
+        if (!compact_keys(vals, n)) {
+            if (!sort_wide_keys(vals, (size_t)n, perm)) return 0;
+            v->version = store->version;
+            return 1;
+        }
+        for (int i = 0; i < n; ++i) vals[i] = vals[i] << 32 | (uint32_t)i;
+    }
+    radix_sort_u64(vals, tmp, n, 4);
+    for (int i = 0; i < n; ++i) perm[i] = (int)(uint32_t)vals[i];
+    v->version = store->version;
+    return 1;
+}
+
+// rows in field order (SORT_BY_*), ties in file order; cached until the store
+// changes. Owned by the store; NULL when out of memory.
+const int *store_sorted_view(RecordStore *store, int field) {
+    if (field < 0 || field >= SORT_FIELD_COUNT) return NULL;
+    if (store->views[field].version != store->version && !store_build_view(store, field)) return NULL;
+    return store->views[field].perm;
+}
+
+// inverse of store_sorted_view: position of each row in field order
+const int *store_sorted_rank(RecordStore *store, int field) {
+    const int *perm = store_sorted_view(store, field);
+    if (!perm) return NULL;
+    SortView *v = &store->views[field];
+    if (v->rank_version != store->version) {
+        int *rank = realloc(v->rank, sizeof(int) * (store->count ? (size_t)store->count : 1));
+        if (!rank) return NULL;
+        v->rank = rank;
+        for (int i = 0; i < store->count; ++i) rank[perm[i]] = i;
+        v->rank_version = store->version;
+    }
+    return v->rank;
+}
+
+/* ---------- Reports (streaming group-by) ---------- */
+
+// Open-addressing counter keyed by a 32-bit id (owner handle); slots hold key + 1, 0 = empty
+static int count_map_grow(CountMap *m) {
+    uint32_t cap = m->cap ? m->cap * 2 : REPORT_MAP_INITIAL_SLOTS;
+    CountSlot *slots = calloc(cap, sizeof(CountSlot));
+    if (!slots) return 0;
+    for (uint32_t i = 0; i < m->cap; ++i) {
+        if (!m->slots[i].key) continue;
+        uint32_t s = (m->slots[i].key - 1) * 2654435761u & (cap - 1);
+        while (slots[s].key) s = (s + 1) & (cap - 1);
+        slots[s] = m->slots[i];
+    }
+    free(m->slots);
+    m->slots = slots;
+    m->cap = cap;
+    return 1;
+}
+
+static int count_map_add(CountMap *m, uint32_t key, uint32_t n) {
+    if (2 * (m->used + 1) > m->cap && !count_map_grow(m)) return 0;
+    uint32_t s = key * 2654435761u & (m->cap - 1);
+    while (m->slots[s].key && m->slots[s].key != key + 1) s = (s + 1) & (m->cap - 1);
+    if (!m->slots[s].key) {
+        m->slots[s].key = key + 1;
+        m->used++;
+    }
+    m->slots[s].count += n;
+    return 1;
+}
+
+void report_init(Report *r) {
+    memset(r, 0, sizeof(*r));
+}
+
+void report_free(Report *r) {
+    free(r->owners.slots);
+    report_init(r);
+}
+
+// AAA..ZZZ -> 0..REPORT_PREFIXES-1 from a folded plate key; -1 if the plate does not start with three letters
+static int plate_prefix_index(const KeySlot *k) {
+    if (!CHAR_IS(k->b[0], CC_UPPER) || !CHAR_IS(k->b[1], CC_UPPER) || !CHAR_IS(k->b[2], CC_UPPER)) return -1;
+    return ((k->b[0] - 'A') * 26 + (k->b[1] - 'A')) * 26 + (k->b[2] - 'A');
+}
+
+// one row into the accumulators; day is a date_day_number
+static void report_add(Report *r, uint32_t day, const KeySlot *plate, OwnerHandle owner) {
+    int month = day_month_index(day);
+    if (month >= 0) r->months[month]++;
+    else r->undated++;
+    int prefix = plate_prefix_index(plate);
+    if (prefix >= 0) r->prefixes[prefix]++;
+    else r->unprefixed++;
+    if (owner != OWNER_HANDLE_NONE && !count_map_add(&r->owners, owner, 1)) r->oom = 1;
+    r->rows++;
+}
+
+int report_merge(Report *dst, const Report *src) {
+    for (int i = 0; i < REPORT_MONTHS; ++i) dst->months[i] += src->months[i];
+    for (int i = 0; i < REPORT_PREFIXES; ++i) dst->prefixes[i] += src->prefixes[i];
+    for (uint32_t i = 0; i < src->owners.cap; ++i) {
+        const CountSlot *s = &src->owners.slots[i];
+        if (s->key && !count_map_add(&dst->owners, s->key - 1, s->count)) dst->oom = 1;
+    }
+    dst->undated += src->undated;
+    dst->unprefixed += src->unprefixed;
+    dst->rows += src->rows;
+    dst->oom |= src->oom;
+    return !dst->oom;
+}
+
+// reads only the day / plate-key columns and the owner handle of each row
+static void report_chunk(int begin, int end, void *ctx, void *out) {
+    const RecordStore *store = ctx;
+    Report *r = out;
+    for (int i = begin; i < end; ++i) report_add(r, store->day_keys[i], &store->reg_keys[i], store->rows[i].owner);
+}
+
+// group-by counts over the store in one pass; each scan chunk fills its own
+// Report and the chunks are merged at the end. pool NULL = calling thread only.
+// out must be report_init'd; owner keys are handles into store->owners.
+int report_build(const RecordStore *store, ThreadPool *pool, Report *out) {
+    int chunks = scan_chunk_count(pool, store->count);
+    if (chunks == 0) return 1;
+    Report *parts = calloc((size_t)chunks, sizeof(Report));
+    if (!parts) return 0;
+    parallel_scan(pool, store->count, report_chunk, (void *)store, parts, sizeof(Report));
+    for (int c = 0; c < chunks; ++c) {
+        report_merge(out, &parts[c]);
+        report_free(&parts[c]);
+    }
+    free(parts);
+    return !out->oom;
+}
+
+// the same counts straight from a CSV stream, one line at a time, without
+// building a store; owner keys are handles into names (interned as they appear)
+int report_stream_csv(FILE *fp, Report *out, OwnerPool *names) {
+    char line[MAX_LINE];
+    Record r;
+    KeySlot plate;
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strip_line_ending(line)) continue;
+        if (!parse_record_line(line, &r)) continue;
+        OwnerHandle owner = owner_intern(names, r.owner);
+        if (owner == OWNER_HANDLE_NONE) out->oom = 1;
+        key_slot_set(&plate, r.carReg);
+        report_add(out, date_day_number(r.date), &plate, owner);
+    }
+    return !out->oom;
+}
+
+// keep the k largest (count desc, key asc) in top[0..*len)
+static void top_insert(CountSlot *top, int *len, int k, uint32_t key, uint32_t count) {
+    if (count == 0) return;
+    int pos = *len;
+    while (pos > 0 && (top[pos - 1].count < count || (top[pos - 1].count == count && top[pos - 1].key > key))) --pos;
+    if (pos >= k) return;
+    int last = *len < k ? *len : k - 1;
+    memmove(&top[pos + 1], &top[pos], sizeof(CountSlot) * (last - pos));
+    top[pos].key = key;
+    top[pos].count = count;
+    if (*len < k) (*len)++;
+}
+
+// the k most frequent plate prefixes (key = prefix index); returns how many were filled
+int report_top_prefixes(const Report *r, CountSlot *top, int k) {
+    int len = 0;
+    for (int i = 0; i < REPORT_PREFIXES; ++i) top_insert(top, &len, k, (uint32_t)i, r->prefixes[i]);
+    return len;
+}
+
+// the k most frequent owners (key = owner handle)
+int report_top_owners(const Report *r, CountSlot *top, int k) {
+    int len = 0;
+    for (uint32_t i = 0; i < r->owners.cap; ++i) {
+        const CountSlot *s = &r->owners.slots[i];
+        if (s->key) top_insert(top, &len, k, s->key - 1, s->count);
+    }
+    return len;
+}
+
+/* ---------- Top-K by date (bounded heap) ---------- */
+
+// max-heap on key
+static void heap_sift_down(HeapItem *h, int n, int i) {
+    while (1) {
+        int l = 2 * i + 1, m = i;
+        if (l < n && h[l].key > h[m].key) m = l;
+        if (l + 1 < n && h[l + 1].key > h[m].key) m = l + 1;
+        if (m == i) return;
+        HeapItem t = h[i];
+        h[i] = h[m];
+        h[m] = t;
+        i = m;
+    }
+}
+
+static void heap_sift_up(HeapItem *h, int i) {
+    while (i > 0 && h[(i - 1) / 2].key < h[i].key) {
+        HeapItem t = h[i];
+        h[i] = h[(i - 1) / 2];
+        h[(i - 1) / 2] = t;
+        i = (i - 1) / 2;
+    }
+}
+
+// Keeps the k best rows seen so far. Rows are ranked by (day << 32 | seq), the
+// same order as the date view, so ties go to the earlier row for oldest and the
+// later row for newest; newest ranks by the complement. The heap root is the
+// worst row kept, so most rows are rejected with one compare.
+typedef struct {
+    HeapItem *items;
+    int len;
+    int k;
+    int newest;
+} TopK;
+
+// slot to store the row's payload in, or -1 if the row does not make the top k
+static int topk_offer(TopK *t, uint32_t day, uint32_t seq) {
+    uint64_t key = (uint64_t)day << 32 | seq;
+    if (t->newest) key = ~key;
+    if (t->len < t->k) {
+        int slot = t->len;
+        t->items[slot].key = key;
+        t->items[slot].slot = slot;
+        heap_sift_up(t->items, t->len++);
+        return slot;
+    }
+    if (key >= t->items[0].key) return -1;
+    int slot = t->items[0].slot; // the evicted row's slot is reused
+    t->items[0].key = key;
+    heap_sift_down(t->items, t->len, 0);
+    return slot;
+}
+
+// heap sort in place: items[0..len) end up best first
+static void topk_finish(TopK *t) {
+    for (int n = t->len; n > 1; --n) {
+        HeapItem last = t->items[n - 1];
+        t->items[n - 1] = t->items[0];
+        t->items[0] = last;
+        heap_sift_down(t->items, n - 1, 0);
+    }
+}
+
+static uint32_t topk_seq(const TopK *t, int i) {
+    return (uint32_t)(t->newest ? ~t->items[i].key : t->items[i].key);
+}
+
+// the k most recent (newest) or oldest rows by InspectionDate, best first, in
+// O(n log k) time and O(k) memory; rows without a valid date are skipped.
+// Returns the row count (-1 when out of memory); *out_rows lives in the arena.
+int store_top_k_by_date(const RecordStore *store, int k, int newest, Arena *arena, int **out_rows) {
+    *out_rows = NULL;
+    if (k > store->count) k = store->count;
+    if (k <= 0) return 0;
+    TopK t = { arena_alloc(arena, sizeof(HeapItem) * (size_t)k), 0, k, newest };
+    int *rows = arena_alloc(arena, sizeof(int) * (size_t)k);
+    if (!t.items || !rows) return -1;
+    for (int i = 0; i < store->count; ++i) {
+        if (store->day_keys[i] != UINT32_MAX) topk_offer(&t, store->day_keys[i], (uint32_t)i);
+    }
+    topk_finish(&t);
+    for (int i = 0; i < t.len; ++i) rows[i] = (int)topk_seq(&t, i);
+    *out_rows = rows;
+    return t.len;
+}
+
+// offer every row of fp to t, keeping the winners' records in kept; *seq numbers the rows
+static void topk_stream(TopK *t, Record *kept, FILE *fp, uint32_t *seq) {
+    char line[MAX_LINE];
+    Record r;
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strip_line_ending(line)) continue;
+        if (!parse_record_line(line, &r)) continue;
+        uint32_t day = date_day_number(r.date);
+        if (day == UINT32_MAX) {
+            (*seq)++;
+            continue;
+        }
+        int slot = topk_offer(t, day, (*seq)++);
+        if (slot >= 0) kept[slot] = r;
+    }
+}
+
+// the same query over a CSV stream, one line at a time: only the k kept
+// records are held. out must have room for k; returns the count, -1 when out of memory.
+int top_k_stream_csv(FILE *fp, int k, int newest, Record *out) {
+    if (k <= 0) return 0;
+    TopK t = { malloc(sizeof(HeapItem) * (size_t)k), 0, k, newest };
+    Record *kept = malloc(sizeof(Record) * (size_t)k);
+    if (!t.items || !kept) {
+        free(t.items);
+        free(kept);
+        return -1;
+    }
+    uint32_t seq = 0;
+    topk_stream(&t, kept, fp, &seq);
+    topk_finish(&t);
+    for (int i = 0; i < t.len; ++i) out[i] = kept[t.items[i].slot];
+    int n = t.len;
+    free(t.items);
+    free(kept);
+    return n;
+}
+
+// top_k_stream_csv over the partitions, archived ones included: newest (or oldest)
+// partitions first, stopping at the first one whose whole date range is behind the k
+// rows already kept. Returns the count, -1 when out of memory or without a manifest;
+// partitions that cannot be opened are skipped, as in partition_range
+int partition_top_k(PartitionLayout *pl, int k, int newest, Record *out) {
+    pl->error[0] = '\0';
+    if (k <= 0) return 0;
+    if (!partition_manifest_read(pl)) return -1;
+    TopK t = { malloc(sizeof(HeapItem) * (size_t)k), 0, k, newest };
+    Record *kept = malloc(sizeof(Record) * (size_t)k);
+    int *visit = malloc(sizeof(int) * (size_t)(pl->count ? pl->count : 1));
+    if (!t.items || !kept || !visit) {
+        free(t.items);
+        free(kept);
+        free(visit);
+        return -1;
+    }
+    // dated partitions by last date descending (newest) or first date ascending (oldest)
+    int n = 0;
+    for (int i = 0; i < pl->count; ++i) {
+        if (pl->parts[i].min_day > pl->parts[i].max_day) continue;
+        int j = n++;
+        for (; j > 0; --j) {
+            const PartitionInfo *a = &pl->parts[visit[j - 1]], *b = &pl->parts[i];
+            if (newest ? a->max_day >= b->max_day : a->min_day <= b->min_day) break;
+            visit[j] = visit[j - 1];
+        }
+        visit[j] = i;
+    }
+    char path[MAX_LINE];
+    uint32_t seq = 0;
+    for (int v = 0; v < n; ++v) {
+        const PartitionInfo *p = &pl->parts[visit[v]];
+        if (t.len == k) {
+            uint32_t worst = (uint32_t)((newest ? ~t.items[0].key : t.items[0].key) >> 32);
+            if (newest ? p->max_day < worst : p->min_day > worst) {
+                pl->files_pruned += n - v;
+                break;
+            }
+        }
+        partition_path(pl, p, path, sizeof(path));
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            partition_error(pl, path, errno);
+            continue;
+        }
+        topk_stream(&t, kept, f, &seq);
+        fclose(f);
+        pl->files_read++;
+    }
+    topk_finish(&t);
+    for (int i = 0; i < t.len; ++i) out[i] = kept[t.items[i].slot];
+    int found = t.len;
+    free(t.items);
+    free(kept);
+    free(visit);
+    return found;
+}
+
+/* ---------- Per-plate inspection history (secondary index) ---------- */
+
+typedef struct {
+    const char *reg;
+    int row;
+} PlateRow;
+
+static int plate_row_cmp(const void *a, const void *b) {
+    const PlateRow *x = a, *y = b;
+    int c = strcasecmp(x->reg, y->reg);
+    return c ? c : (x->row > y->row) - (x->row < y->row);
+}
+
+// Groups rows by plate, each group in date order, from the two cached views:
+// the plate view numbers the groups, then one walk of the date view drops every
+// row into its group's next free cell (a counting sort, so no further compares).
+static int store_build_plate_index(RecordStore *store) {
+    PlateIndex *ix = &store->plate_index;
+    int n = store->count;
+    const int *by_plate = store_sorted_view(store, SORT_BY_PLATE);
+    const int *by_date = store_sorted_view(store, SORT_BY_DATE);
+    if (!by_plate || !by_date) return 0;
+    size_t cells = n ? (size_t)n : 1;
+    int *rows = realloc(ix->rows, sizeof(int) * cells);
+    if (!rows) return 0;
+    ix->rows = rows;
+    PlateGroup *groups = realloc(ix->groups, sizeof(PlateGroup) * cells);
+    if (!groups) return 0;
+    ix->groups = groups;
+    int *group_of = malloc(sizeof(int) * cells);
+    if (!group_of) return 0;
+
+    int ng = 0;
+    for (int i = 0; i < n;) {
+        const KeySlot *k = &store->reg_keys[by_plate[i]];
+        uint64_t key = plate_sort_key(k);
+        int j = i + 1;
+        while (j < n && plate_sort_key(&store->reg_keys[by_plate[j]]) == key) ++j;
+        if (!key_slot_is_overflow(k)) {
+            groups[ng].key = key;
+            groups[ng].count = j - i;
+            for (int r = i; r < j; ++r) group_of[by_plate[r]] = ng;
+            ng++;
+        } else {
+            // plates too long for a key slot all share the overflow key: split the run by the full string
+            PlateRow *run = malloc(sizeof(PlateRow) * (size_t)(j - i));
+            if (!run) {
+                free(group_of);
+                return 0;
+            }
+            for (int r = i; r < j; ++r) {
+                run[r - i].reg = store->rows[by_plate[r]].carReg;
+                run[r - i].row = by_plate[r];
+            }
+            qsort(run, j - i, sizeof(PlateRow), plate_row_cmp);
+            for (int r = 0; r < j - i; ++r) {
+                if (r == 0 || strcasecmp(run[r].reg, run[r - 1].reg) != 0) {
+                    groups[ng].key = key;
+                    groups[ng].count = 0;
+                    ng++;
+                }
+                group_of[run[r].row] = ng - 1;
+                groups[ng - 1].count++;
+            }
+            free(run);
+        }
+        i = j;
+    }
+
+    int begin = 0;
+    for (int g = 0; g < ng; ++g) {
+        groups[g].begin = begin;
+        begin += groups[g].count;
+        groups[g].count = 0; // refilled below
+    }
+    for (int i = 0; i < n; ++i) {
+        PlateGroup *g = &groups[group_of[by_date[i]]];
+        rows[g->begin + g->count++] = by_date[i];
+    }
+    free(group_of);
+    ix->ngroups = ng;
+    ix->version = store->version;
+    return 1;
+}
+
+// the per-plate index, rebuilt when the store has changed; NULL when out of memory
+const PlateIndex *store_plate_index(RecordStore *store) {
+    if (store->plate_index.version != store->version && !store_build_plate_index(store)) return NULL;
+    return &store->plate_index;
+}
+
+// binary search over the plate groups (case-insensitive); NULL if the plate has no rows
+static const PlateGroup *plate_index_find(const RecordStore *store, const PlateIndex *ix, const char *plate) {
+    KeySlot k;
+    key_slot_set(&k, plate);
+    uint64_t key = plate_sort_key(&k);
+    int overflow = key_slot_is_overflow(&k);
+    int lo = 0, hi = ix->ngroups;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const PlateGroup *g = &ix->groups[mid];
+        int c = g->key < key ? -1 : g->key > key;
+        if (c == 0 && overflow) c = strcasecmp(store->rows[ix->rows[g->begin]].carReg, plate);
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == ix->ngroups) return NULL;
+    const PlateGroup *g = &ix->groups[lo];
+    if (g->key != key || (overflow && strcasecmp(store->rows[ix->rows[g->begin]].carReg, plate) != 0)) return NULL;
+    return g;
+}
+
+// latest row of a group: the last one with a valid date (invalid dates sort after every valid one)
+static int plate_group_latest(const RecordStore *store, const PlateIndex *ix, const PlateGroup *g) {
+    for (int i = g->begin + g->count - 1; i > g->begin; --i) {
+        if (store->day_keys[ix->rows[i]] != UINT32_MAX) return ix->rows[i];
+    }
+    return ix->rows[g->begin];
+}
+
+// every inspection of a plate, oldest first; returns the count (0 = unknown plate, -1 = out of memory).
+// *rows points into the index and is valid until the store changes.
+int store_plate_history(RecordStore *store, const char *plate, const int **rows) {
+    *rows = NULL;
+    const PlateIndex *ix = store_plate_index(store);
+    if (!ix) return -1;
+    const PlateGroup *g = plate_index_find(store, ix, plate);
+    if (!g) return 0;
+    *rows = &ix->rows[g->begin];
+    return g->count;
+}
+
+// row of the plate's most recent inspection, -1 if none (or out of memory)
+int store_plate_latest(RecordStore *store, const char *plate) {
+    const PlateIndex *ix = store_plate_index(store);
+    if (!ix) return -1;
+    const PlateGroup *g = plate_index_find(store, ix, plate);
+    return g ? plate_group_latest(store, ix, g) : -1;
+}
+
+// the latest inspection of every plate whose latest date is before cutoff_day
+// (or has no valid date), in plate order. Walks one entry per plate, not every row.
+int store_overdue(RecordStore *store, uint32_t cutoff_day, Arena *arena, int **out_rows) {
+    *out_rows = NULL;
+    const PlateIndex *ix = store_plate_index(store);
+    if (!ix) return -1;
+    if (ix->ngroups == 0) return 0;
+    int *rows = arena_alloc(arena, sizeof(int) * (size_t)ix->ngroups);
+    if (!rows) return -1;
+    int n = 0;
+    for (int g = 0; g < ix->ngroups; ++g) {
+        int row = plate_group_latest(store, ix, &ix->groups[g]);
+        if (store->day_keys[row] < cutoff_day || store->day_keys[row] == UINT32_MAX) rows[n++] = row;
+    }
+    *out_rows = rows;
+    return n;
+}
+
+// the date `days` before today as DD/MM/YYYY in out, returning its date_day_number
+// (0 when that is before MIN_YEAR, so no valid date is older)
+uint32_t date_days_ago(int days, char *out) {
+    time_t t = time(NULL) - (time_t)days * 24 * 60 * 60;
+    struct tm local;
+#if defined(_WIN32) || defined(_WIN64)
+    struct tm *tm = localtime_s(&local, &t) == 0 ? &local : NULL;
+#else
+    struct tm *tm = localtime_r(&t, &local);
+#endif
+    if (!tm || !strftime(out, DATE_BUFFER_LEN, "%d/%m/%Y", tm)) {
+        out[0] = '\0';
+        return 0;
+    }
+    uint32_t day = date_day_number(out);
+    return day == UINT32_MAX ? 0 : day;
+}
+
+/* ---------- Filter expressions (compiled column predicates) ---------- */
+
+// parse tree, only alive while compiling: AND / OR nodes hold a list of children
+typedef struct {
+    int kind; // QUERY_NODE_*
+    int pred;
+    int first; // first child, -1 for none
+    int next; // next sibling
+    double estimate;
+} QueryNode;
+
+typedef struct {
+    const char *src;
+    const char *p;
+    Query *q;
+    QueryNode nodes[QUERY_MAX_NODES];
+    int nnodes;
+    int nesting; // open parentheses and nots, bounds the recursion
+} QueryParser;
+
+static const char *query_field_name(int field) {
+    static const char *names[] = {"id", "plate", "owner", "date"};
+    return names[field];
+}
+
+// QUERY_FIELD_* for a field name (short or the CSV column name, any case), or -1
+int query_field_lookup(const char *name) {
+    static const char *names[][2] = {
+        {"id", "inspectionid"}, {"plate", "carregnumber"}, {"owner", "ownername"}, {"date", "inspectiondate"}
+    };
+    for (int f = 0; f < 4; ++f) {
+        if (strcasecmp(name, names[f][0]) == 0 || strcasecmp(name, names[f][1]) == 0) return f;
+    }
+    if (strcasecmp(name, "carreg") == 0) return QUERY_FIELD_PLATE;
+    return -1;
+}
+
+static const char *query_op_name(int op) {
+    static const char *names[] = {"=", "!=", "^=", "~", "<", "<=", ">", ">="};
+    return names[op];
+}
+
+static int query_fail(QueryParser *ps, const char *what) {
+    if (!ps->q->error[0]) {
+        snprintf(ps->q->error, sizeof(ps->q->error), "%s at column %d", what, (int)(ps->p - ps->src) + 1);
+    }
+    return -1;
+}
+
+static void query_skip_space(QueryParser *ps) {
+    while (isspace((unsigned char)*ps->p)) ps->p++;
+}
+
+// consume the keyword (and / or / not) when it is the next word
+static int query_keyword(QueryParser *ps, const char *kw) {
+    query_skip_space(ps);
+    size_t n = strlen(kw);
+    for (size_t i = 0; i < n; ++i) {
+        if (tolower((unsigned char)ps->p[i]) != kw[i]) return 0;
+    }
+    if (isalnum((unsigned char)ps->p[n]) || ps->p[n] == '_') return 0;
+    ps->p += n;
+    return 1;
+}
+
+static int query_node(QueryParser *ps, int kind, int pred) {
+    if (ps->nnodes == QUERY_MAX_NODES) return query_fail(ps, "filter too long");
+    QueryNode *n = &ps->nodes[ps->nnodes];
+    n->kind = kind;
+    n->pred = pred;
+    n->first = -1;
+    n->next = -1;
+    n->estimate = kind == QUERY_NODE_PRED ? ps->q->preds[pred].estimate : 1.0;
+    return ps->nnodes++;
+}
+
+// rough share of rows a predicate keeps; only the order of operands depends on it
+static double query_pred_estimate(const QueryPred *p) {
+    double eq = p->field == QUERY_FIELD_OWNER ? 0.01 : p->field == QUERY_FIELD_DATE ? 0.001 : 0.0001;
+    switch (p->op) {
+        case QUERY_EQ:
+            return eq;
+        case QUERY_NE:
+            return 1.0 - eq;
+        case QUERY_PREFIX: {
+            double s = 1.0;
+            for (size_t i = 0; i < p->len && s > eq; ++i) s /= 26.0;
+            return s > eq ? s : eq;
+        }
+        case QUERY_CONTAINS:
+            return 0.1;
+        default:
+            return 1.0 / 3.0; // a range keeps about a third
+    }
+}
+
+static int query_parse_pred(QueryParser *ps) {
+    Query *q = ps->q;
+    if (q->npreds == QUERY_MAX_PREDICATES) return query_fail(ps, "too many conditions");
+    QueryPred *p = &q->preds[q->npreds];
+    memset(p, 0, sizeof(*p));
+
+    query_skip_space(ps);
+    char word[INPUT_BUFFER_SIZE];
+    size_t n = 0;
+    while ((isalnum((unsigned char)*ps->p) || *ps->p == '_') && n < sizeof(word) - 1) word[n++] = (char)tolower((unsigned char)*ps->p++);
+    word[n] = '\0';
+    if (n == 0) return query_fail(ps, "expected a field (id, plate, owner or date)");
+    p->field = query_field_lookup(word);
+    if (p->field < 0) return query_fail(ps, "unknown field (use id, plate, owner or date)");
+
+    query_skip_space(ps);
+    const char *s = ps->p;
+    if (s[0] == '=' && s[1] == '=') p->op = QUERY_EQ, ps->p += 2;
+    else if (s[0] == '!' && s[1] == '=') p->op = QUERY_NE, ps->p += 2;
+    else if (s[0] == '^' && s[1] == '=') p->op = QUERY_PREFIX, ps->p += 2;
+    else if (s[0] == '<' && s[1] == '=') p->op = QUERY_LE, ps->p += 2;
+    else if (s[0] == '>' && s[1] == '=') p->op = QUERY_GE, ps->p += 2;
+    else if (s[0] == '=') p->op = QUERY_EQ, ps->p++;
+    else if (s[0] == '~') p->op = QUERY_CONTAINS, ps->p++;
+    else if (s[0] == '<') p->op = QUERY_LT, ps->p++;
+    else if (s[0] == '>') p->op = QUERY_GT, ps->p++;
+    else return query_fail(ps, "expected an operator (=, !=, ^=, ~, <, <=, >, >=)");
+    int ordered = p->op >= QUERY_LT;
+    if (p->field == QUERY_FIELD_DATE && (p->op == QUERY_PREFIX || p->op == QUERY_CONTAINS)) {
+        ps->p = s;
+        return query_fail(ps, "date takes =, !=, <, <=, > or >=");
+    }
+    if (p->field != QUERY_FIELD_DATE && ordered) {
+        ps->p = s;
+        return query_fail(ps, "only date can be compared with < or >");
+    }
+
+    query_skip_space(ps);
+    n = 0;
+    if (*ps->p == '"') {
+        ps->p++;
+        while (*ps->p && *ps->p != '"' && n < sizeof(p->text) - 1) p->text[n++] = *ps->p++;
+        if (*ps->p != '"') return query_fail(ps, "unterminated or too long quoted value");
+        ps->p++;
+    } else {
+        while (*ps->p && !isspace((unsigned char)*ps->p) && *ps->p != '(' && *ps->p != ')' &&
+               n < sizeof(p->text) - 1) {
+            p->text[n++] = *ps->p++;
+        }
+    }
+    p->text[n] = '\0';
+    if (n == 0) return query_fail(ps, "expected a value");
+    if (p->field == QUERY_FIELD_DATE) {
+        char norm[DATE_BUFFER_LEN];
+        if (!is_valid_date(p->text, norm)) return query_fail(ps, "expected a date DD/MM/YYYY");
+        snprintf(p->text, sizeof(p->text), "%s", norm);
+        p->day = date_day_number(norm);
+    }
+    p->len = strlen(p->text);
+    for (size_t i = 0; i <= p->len; ++i) p->folded[i] = (char)tolower((unsigned char)p->text[i]);
+    p->estimate = query_pred_estimate(p);
+    return query_node(ps, QUERY_NODE_PRED, q->npreds++);
+}
+
+static int query_parse_or(QueryParser *ps);
+
+static int query_parse_not(QueryParser *ps) {
+    if (ps->nesting > QUERY_MAX_DEPTH) return query_fail(ps, "filter nested too deeply");
+    if (query_keyword(ps, "not")) {
+        ps->nesting++;
+        int child = query_parse_not(ps);
+        ps->nesting--;
+        if (child < 0) return -1;
+        int n = query_node(ps, QUERY_NODE_NOT, -1);
+        if (n < 0) return -1;
+        ps->nodes[n].first = child;
+        ps->nodes[n].estimate = 1.0 - ps->nodes[child].estimate;
+        return n;
+    }
+    query_skip_space(ps);
+    if (*ps->p != '(') return query_parse_pred(ps);
+    ps->p++;
+    ps->nesting++;
+    int n = query_parse_or(ps);
+    ps->nesting--;
+    if (n < 0) return -1;
+    query_skip_space(ps);
+    if (*ps->p != ')') return query_fail(ps, "expected ')'");
+    ps->p++;
+    return n;
+}
+
+// one operand, or an AND / OR node over two or more (kind) joined by keyword
+static int query_parse_list(QueryParser *ps, int kind, const char *keyword, int (*operand)(QueryParser *)) {
+    int first = operand(ps);
+    if (first < 0 || !query_keyword(ps, keyword)) return first;
+    int n = query_node(ps, kind, -1);
+    if (n < 0) return -1;
+    QueryNode *list = &ps->nodes[n];
+    list->first = first;
+    int last = first;
+    do {
+        int next = operand(ps);
+        if (next < 0) return -1;
+        ps->nodes[last].next = next;
+        last = next;
+    } while (query_keyword(ps, keyword));
+    // independent operands: AND multiplies the shares kept, OR adds them
+    double est = kind == QUERY_NODE_AND ? 1.0 : 0.0;
+    for (int c = list->first; c >= 0; c = ps->nodes[c].next) {
+        est = kind == QUERY_NODE_AND ? est * ps->nodes[c].estimate : est + ps->nodes[c].estimate;
+    }
+    list->estimate = est < 1.0 ? est : 1.0;
+    return n;
+}
+
+static int query_parse_and(QueryParser *ps) {
+    return query_parse_list(ps, QUERY_NODE_AND, "and", query_parse_not);
+}
+
+static int query_parse_or(QueryParser *ps) {
+    return query_parse_list(ps, QUERY_NODE_OR, "or", query_parse_and);
+}
+
+static int query_emit(QueryParser *ps, int op, int pred, int *depth) {
+    Query *q = ps->q;
+    if (q->ncode == QUERY_MAX_PROGRAM) return query_fail(ps, "filter too long");
+    q->code[q->ncode].op = op;
+    q->code[q->ncode].pred = pred;
+    q->ncode++;
+    if (op == QUERY_OP_PRED) ++*depth;
+    else if (op == QUERY_OP_AND || op == QUERY_OP_OR) --*depth;
+    if (*depth > q->depth) q->depth = *depth;
+    if (q->depth > QUERY_MAX_DEPTH) return query_fail(ps, "filter nested too deeply");
+    return 0;
+}
+
+// postfix code for node; AND operands cheapest first, OR operands broadest first
+static int query_compile_node(QueryParser *ps, int node, int *depth) {
+    QueryNode *n = &ps->nodes[node];
+    if (n->kind == QUERY_NODE_PRED) return query_emit(ps, QUERY_OP_PRED, n->pred, depth);
+    if (n->kind == QUERY_NODE_NOT) {
+        if (query_compile_node(ps, n->first, depth) < 0) return -1;
+        return query_emit(ps, QUERY_OP_NOT, -1, depth);
+    }
+    int and = n->kind == QUERY_NODE_AND, order[QUERY_MAX_NODES] = {0}, count = 0;
+    for (int c = n->first; c >= 0; c = ps->nodes[c].next) {
+        int j = count++;
+        for (; j > 0; --j) {
+            double a = ps->nodes[order[j - 1]].estimate, b = ps->nodes[c].estimate;
+            if (and ? a <= b : a >= b) break;
+            order[j] = order[j - 1];
+        }
+        order[j] = c;
+    }
+    if (query_compile_node(ps, order[0], depth) < 0) return -1;
+    for (int i = 1; i < count; ++i) {
+        const QueryNode *c = &ps->nodes[order[i]];
+        if (c->kind == QUERY_NODE_PRED) {
+            if (query_emit(ps, and ? QUERY_OP_AND_PRED : QUERY_OP_OR_PRED, c->pred, depth) < 0) return -1;
+        } else if (query_compile_node(ps, order[i], depth) < 0 ||
+                   query_emit(ps, and ? QUERY_OP_AND : QUERY_OP_OR, -1, depth) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// parse and compile text into q; 0 with the reason in q->error when it is not a filter
+int query_compile(Query *q, const char *text) {
+    memset(q, 0, sizeof(*q));
+    QueryParser *ps = malloc(sizeof(QueryParser));
+    if (!ps) {
+        snprintf(q->error, sizeof(q->error), "out of memory");
+        return 0;
+    }
+    ps->src = ps->p = text;
+    ps->q = q;
+    ps->nnodes = 0;
+    ps->nesting = 0;
+    int depth = 0, root = query_parse_or(ps);
+    query_skip_space(ps);
+    if (root >= 0 && *ps->p) root = query_fail(ps, "expected 'and', 'or' or the end");
+    if (root >= 0 && query_compile_node(ps, root, &depth) == 0) q->estimate = ps->nodes[root].estimate;
+    free(ps);
+    return q->error[0] == '\0';
+}
+
+// whether input is a filter rather than a bare InspectionID / CarRegNumber
+int query_is_filter(const char *s) {
+    return strpbrk(s, "=~<>") != NULL;
+}
+
+static int query_has_prefix(const char *s, const char *folded, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (tolower((unsigned char)s[i]) != folded[i]) return 0; // also stops at s's NUL
+    }
+    return 1;
+}
+
+static int query_contains(const char *s, const char *folded, size_t len) {
+    for (; *s; ++s) {
+        if (query_has_prefix(s, folded, len)) return 1;
+    }
+    return len == 0;
+}
+
+// predicate on one string value (owner names and key fields that do not fit a slot)
+int query_string_matches(const QueryPred *p, const char *s) {
+    switch (p->op) {
+        case QUERY_PREFIX:
+            return query_has_prefix(s, p->folded, p->len);
+        case QUERY_CONTAINS:
+            return query_contains(s, p->folded, p->len);
+        default: // = and != (negated by the caller)
+            return strcasecmp(s, p->text) == 0;
+    }
+}
+
+// whether r satisfies q, running the program on the record's own strings; for rows that
+// are not in a RecordStore's columns (a snapshot's)
+int query_record_matches(const Query *q, const Record *r) {
+    int stack[QUERY_MAX_DEPTH], top = 0;
+    uint32_t day = date_day_number(r->date);
+    for (int i = 0; i < q->ncode; ++i) {
+        const QueryInstr *in = &q->code[i];
+        int v = 0;
+        if (in->pred >= 0) {
+            const QueryPred *p = &q->preds[in->pred];
+            switch (p->field) {
+                case QUERY_FIELD_DATE:
+                    v = p->op == QUERY_EQ ? day == p->day : p->op == QUERY_NE ? day != p->day
+                      : day == UINT32_MAX ? 0 : p->op == QUERY_LT ? day < p->day : p->op == QUERY_LE ? day <= p->day
+                      : p->op == QUERY_GT ? day > p->day : day >= p->day;
+                    break;
+                case QUERY_FIELD_OWNER:
+                    v = query_string_matches(p, r->owner);
+                    break;
+                default:
+                    v = query_string_matches(p, p->field == QUERY_FIELD_ID ? r->inspectionID : r->carReg);
+                    break;
+            }
+            if (p->op == QUERY_NE && p->field != QUERY_FIELD_DATE) v = !v;
+        }
+        switch (in->op) {
+            case QUERY_OP_PRED:
+                stack[top++] = v;
+                break;
+            case QUERY_OP_AND_PRED:
+                stack[top - 1] = stack[top - 1] && v;
+                break;
+            case QUERY_OP_OR_PRED:
+                stack[top - 1] = stack[top - 1] || v;
+                break;
+            case QUERY_OP_AND:
+                top--;
+                stack[top - 1] = stack[top - 1] && stack[top];
+                break;
+            case QUERY_OP_OR:
+                top--;
+                stack[top - 1] = stack[top - 1] || stack[top];
+                break;
+            case QUERY_OP_NOT:
+                stack[top - 1] = !stack[top - 1];
+                break;
+        }
+    }
+    return top > 0 && stack[top - 1];
+}
+
+typedef struct {
+    const RecordStore *store;
+    const QueryPred *pred;
+    uint64_t *acc; // bitmap being written (QUERY_OP_PRED) or narrowed / widened
+    int mode; // QUERY_OP_PRED, QUERY_OP_AND_PRED or QUERY_OP_OR_PRED
+    int negate; // != : the complement of =
+    uint32_t lo, hi; // date predicates as an inclusive day range
+    uint64_t want, mask; // key predicates that fit the 8-byte slot: (slot & mask) == want
+    int slot_ok;
+    const unsigned char *owner_hit; // by owner handle
+} QueryScanCtx;
+
+typedef struct {
+    long examined;
+    long matched;
+} QueryScanOut;
+
+// bits of rows base..base+n-1 where the predicate holds (before negation)
+static uint64_t query_scan_word(const QueryScanCtx *c, int base, int n) {
+    const RecordStore *s = c->store;
+    const QueryPred *p = c->pred;
+    uint64_t bits = 0;
+    if (p->field == QUERY_FIELD_DATE) {
+        const uint32_t *d = s->day_keys + base;
+        for (int j = 0; j < n; ++j) bits |= (uint64_t)(d[j] >= c->lo && d[j] <= c->hi) << j;
+    } else if (p->field == QUERY_FIELD_OWNER) {
+        const StoredRow *r = s->rows + base;
+        for (int j = 0; j < n; ++j) bits |= (uint64_t)c->owner_hit[r[j].owner] << j;
+    } else {
+        const KeySlot *k = (p->field == QUERY_FIELD_ID ? s->id_keys : s->reg_keys) + base;
+        const uint64_t overflow = ~0ULL; // every byte KEY_SLOT_OVERFLOW
+        for (int j = 0; j < n; ++j) {
+            uint64_t w = key_slot_word(&k[j]);
+            int hit;
+            if (c->slot_ok && w != overflow) {
+                hit = (w & c->mask) == c->want;
+            } else {
+                const StoredRow *r = &s->rows[base + j];
+                hit = query_string_matches(p, p->field == QUERY_FIELD_ID ? r->inspectionID : r->carReg);
+            }
+            bits |= (uint64_t)hit << j;
+        }
+    }
+    return bits;
+}
+
+static void query_scan_chunk(int begin, int end, void *ctx, void *out) {
+    const QueryScanCtx *c = ctx;
+    QueryScanOut *o = out;
+    int count = c->store->count;
+    o->examined = o->matched = 0;
+    for (int w = begin; w < end; ++w) {
+        int base = w * 64, n = count - base < 64 ? count - base : 64;
+        uint64_t full = n == 64 ? ~0ULL : (1ULL << n) - 1, cur = c->acc[w];
+        if (c->mode == QUERY_OP_AND_PRED && cur == 0) continue;
+        if (c->mode == QUERY_OP_OR_PRED && cur == full) continue;
+        uint64_t bits = query_scan_word(c, base, n);
+        if (c->negate) bits = ~bits & full;
+        o->examined += n;
+        o->matched += __builtin_popcountll(bits);
+        c->acc[w] = c->mode == QUERY_OP_AND_PRED ? cur & bits : c->mode == QUERY_OP_OR_PRED ? cur | bits : bits;
+    }
+}
+
+// run one predicate over the store into acc (see QueryScanCtx.mode); 0 when out of memory
+static int query_scan(QueryPred *p, const RecordStore *store, uint64_t *acc, int mode, Arena *arena) {
+    double t0 = now_ms();
+    QueryScanCtx c;
+    memset(&c, 0, sizeof(c));
+    c.store = store;
+    c.pred = p;
+    c.acc = acc;
+    c.mode = mode;
+    c.negate = p->op == QUERY_NE;
+    if (p->field == QUERY_FIELD_DATE) {
+        // an undated row (UINT32_MAX) is in no range, so it only passes !=
+        c.lo = p->op == QUERY_GT ? p->day + 1 : p->op == QUERY_LT || p->op == QUERY_LE ? 0 : p->day;
+        c.hi = p->op == QUERY_LT ? p->day - 1 : p->op == QUERY_GT || p->op == QUERY_GE ? UINT32_MAX - 1 : p->day;
+        if (p->op == QUERY_LT && p->day == 0) {
+            // nothing is before the first day: an empty range, not day - 1 wrapping to every row
+            c.lo = 1;
+            c.hi = 0;
+        }
+    } else if (p->field == QUERY_FIELD_OWNER) {
+        // each distinct name is tested once, then the rows only look up their handle
+        const OwnerPool *pool = &store->owners;
+        unsigned char *hit = arena_alloc(arena, pool->count ? pool->count : 1);
+        if (!hit) return 0;
+        for (uint32_t h = 0; h < pool->count; ++h) hit[h] = (unsigned char)query_string_matches(p, owner_str(pool, h));
+        c.owner_hit = hit;
+    } else if ((p->op == QUERY_EQ || p->op == QUERY_NE || p->op == QUERY_PREFIX) && p->len <= KEY_SLOT_LEN) {
+        // = compares whole slots; ^= only the prefix's bytes (slots are zero-padded)
+        KeySlot want, mask;
+        key_slot_set(&want, p->text);
+        memset(mask.b, 0, sizeof(mask.b));
+        memset(mask.b, 0xFF, p->op == QUERY_PREFIX ? p->len : KEY_SLOT_LEN);
+        c.want = key_slot_word(&want);
+        c.mask = key_slot_word(&mask);
+        c.slot_ok = c.want != ~0ULL;
+    }
+    int nwords = (store->count + 63) / 64;
+    ThreadPool *pool = store->count > PARALLEL_SCAN_THRESHOLD ? scan_pool() : NULL;
+    QueryScanOut outs[SCAN_MAX_CHUNKS];
+    int chunks = parallel_scan(pool, nwords, query_scan_chunk, &c, outs, sizeof(QueryScanOut));
+    for (int i = 0; i < chunks; ++i) {
+        p->examined += outs[i].examined;
+        p->matched += outs[i].matched;
+    }
+    p->ms += now_ms() - t0;
+    return 1;
+}
+
+// rows of the store where the compiled filter holds, in file order, into arena memory;
+// returns the count, -1 when out of memory
+int query_collect(Query *q, const RecordStore *store, Arena *arena, int **out_rows) {
+    *out_rows = NULL;
+    double t0 = now_ms();
+    for (int i = 0; i < q->npreds; ++i) {
+        q->preds[i].examined = q->preds[i].matched = 0;
+        q->preds[i].ms = 0;
+    }
+    int count = store->count, nwords = (count + 63) / 64;
+    uint64_t *stack[QUERY_MAX_DEPTH] = {NULL};
+    int top = 0;
+    for (int i = 0; i < q->ncode; ++i) {
+        const QueryInstr *in = &q->code[i];
+        switch (in->op) {
+            case QUERY_OP_PRED:
+                if (!stack[top]) stack[top] = arena_alloc(arena, sizeof(uint64_t) * (size_t)(nwords ? nwords : 1));
+                if (!stack[top] || !query_scan(&q->preds[in->pred], store, stack[top], in->op, arena)) return -1;
+                top++;
+                break;
+            case QUERY_OP_AND_PRED:
+            case QUERY_OP_OR_PRED:
+                if (!query_scan(&q->preds[in->pred], store, stack[top - 1], in->op, arena)) return -1;
+                break;
+            case QUERY_OP_AND:
+            case QUERY_OP_OR: {
+                uint64_t *a = stack[top - 2], *b = stack[top - 1];
+                if (in->op == QUERY_OP_AND) {
+                    for (int w = 0; w < nwords; ++w) a[w] &= b[w];
+                } else {
+                    for (int w = 0; w < nwords; ++w) a[w] |= b[w];
+                }
+                top--;
+                break;
+            }
+            case QUERY_OP_NOT: {
+                uint64_t *a = stack[top - 1];
+                for (int w = 0; w < nwords; ++w) a[w] = ~a[w];
+                if (count % 64) a[nwords - 1] &= (1ULL << (count % 64)) - 1;
+                break;
+            }
+        }
+    }
+    int n = 0;
+    for (int w = 0; w < nwords; ++w) n += __builtin_popcountll(stack[0][w]);
+    int *rows = arena_alloc(arena, sizeof(int) * (size_t)(n ? n : 1));
+    if (!rows) return -1;
+    int k = 0;
+    for (int w = 0; w < nwords; ++w) {
+        for (uint64_t bits = stack[0][w]; bits; bits &= bits - 1) rows[k++] = w * 64 + __builtin_ctzll(bits);
+    }
+    *out_rows = rows;
+    q->ran = 1;
+    q->run_ms = now_ms() - t0;
+    return n;
+}
+
+void query_pred_text(const QueryPred *p, char *out, size_t cap) {
+    const char *quote = p->field == QUERY_FIELD_DATE ? "" : "\"";
+    snprintf(out, cap, "%s %s %s%s%s", query_field_name(p->field), query_op_name(p->op), quote, p->text, quote);
+}
+
+static const char *query_access_path(const QueryPred *p) {
+    if (p->field == QUERY_FIELD_DATE) return "day-number column, range test";
+    if (p->field == QUERY_FIELD_OWNER) return "each distinct owner once, then handle column";
+    if (p->op != QUERY_CONTAINS && p->len <= KEY_SLOT_LEN) {
+        return p->op == QUERY_PREFIX ? "key slot column, masked 8-byte compare" : "key slot column, 8-byte compare";
+    }
+    return "key strings, substring test";
+}
+
+// the compiled program, one step per line, and after a run each predicate's selectivity
+void query_explain(const Query *q, int rows, FILE *out) {
+    static const char *step[] = {"scan", "and-scan", "or-scan", "and", "or", "not"};
+    char text[MAX_LINE];
+    fprintf(out, "Plan: %d step(s), %d bitmap(s) of %d rows, est. %.2f%% of rows\n", q->ncode, q->depth, rows,
+            100.0 * q->estimate);
+    for (int i = 0; i < q->ncode; ++i) {
+        const QueryInstr *in = &q->code[i];
+        if (in->pred < 0) {
+            const char *what = in->op == QUERY_OP_NOT ? "(top bitmap, word by word)" : "(top two bitmaps, word by word)";
+            fprintf(out, "  %2d. %-8s %s\n", i + 1, step[in->op], what);
+            continue;
+        }
+        const QueryPred *p = &q->preds[in->pred];
+        query_pred_text(p, text, sizeof(text));
+        fprintf(out, "  %2d. %-8s %-32s %s, est. %.2f%%\n", i + 1, step[in->op], text, query_access_path(p),
+                100.0 * p->estimate);
+    }
+    if (!q->ran) return;
+    fprintf(out, "%-32s | %-10s | %-10s | %-11s | %s\n", "Predicate", "examined", "matched", "selectivity", "time");
+    for (int i = 0; i < q->npreds; ++i) {
+        const QueryPred *p = &q->preds[i];
+        query_pred_text(p, text, sizeof(text));
+        double sel = p->examined ? 100.0 * p->matched / p->examined : 0.0;
+        fprintf(out, "%-32s | %-10ld | %-10ld | %10.2f%% | %.2f ms\n", text, p->examined, p->matched, sel, p->ms);
+    }
+    fprintf(out, "Total %.2f ms\n", q->run_ms);
+}
+
+/* ---------- Export (NDJSON / CSV streams) ---------- */
+
+static const char *export_column_name(int field) {
+    static const char *names[] = {"InspectionID", "CarRegNumber", "OwnerName", "InspectionDate"};
+    return names[field];
+}
+
+// "id,plate,date" -> fields in that order; 0 on an unknown or repeated name
+int export_parse_columns(const char *list, int *columns) {
+    int n = 0, seen[EXPORT_MAX_COLUMNS] = {0};
+    char name[INPUT_BUFFER_SIZE];
+    const char *p = list;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        if (len == 0 || len >= sizeof(name) || n == EXPORT_MAX_COLUMNS) return 0;
+        memcpy(name, p, len);
+        name[len] = '\0';
+        trim_whitespace(name);
+        int f = query_field_lookup(name);
+        if (f < 0 || seen[f]) return 0;
+        seen[f] = 1;
+        columns[n++] = f;
+        p += len;
+        if (*p == ',') p++;
+    }
+    return n;
+}
+
+static void export_flush(ExportWriter *w) {
+    if (w->len && !w->failed && fwrite(w->buf, 1, w->len, w->out) != w->len) w->failed = 1;
+    if (!w->failed) w->bytes += w->len;
+    w->len = 0;
+}
+
+// buf comes from the caller (cap >= EXPORT_ROW_MAX); columns NULL means all four
+void export_begin(ExportWriter *w, FILE *out, int format, const int *columns, int ncolumns, char *buf, size_t cap) {
+    memset(w, 0, sizeof(*w));
+    w->out = out;
+    w->buf = buf;
+    w->cap = cap;
+    w->format = format;
+    w->ncolumns = columns ? ncolumns : EXPORT_MAX_COLUMNS;
+    for (int i = 0; i < w->ncolumns; ++i) w->columns[i] = columns ? columns[i] : i;
+    if (format == EXPORT_CSV) { // a header row naming the projected columns
+        for (int i = 0; i < w->ncolumns; ++i) {
+            const char *name = export_column_name(w->columns[i]);
+            size_t len = strlen(name);
+            if (i) w->buf[w->len++] = ',';
+            memcpy(w->buf + w->len, name, len);
+            w->len += len;
+        }
+        w->buf[w->len++] = '\n';
+    }
+}
+
+// the field as a JSON string body: quote, backslash and control characters escaped
+static char *export_json_escape(char *dst, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            *dst++ = (char)c;
+            continue;
+        }
+        *dst++ = '\\';
+        switch (c) {
+            case '"': *dst++ = '"'; break;
+            case '\\': *dst++ = '\\'; break;
+            case '\n': *dst++ = 'n'; break;
+            case '\r': *dst++ = 'r'; break;
+            case '\t': *dst++ = 't'; break;
+            default:
+                *dst++ = 'u';
+                *dst++ = '0';
+                *dst++ = '0';
+                *dst++ = hex[c >> 4];
+                *dst++ = hex[c & 15];
+                break;
+        }
+    }
+    return dst;
+}
+
+// RFC 4180: a field holding a comma, quote or line break is quoted, its quotes doubled
+static char *export_csv_escape(char *dst, const char *s) {
+    if (!s[strcspn(s, ",\"\r\n")]) {
+        size_t len = strlen(s);
+        memcpy(dst, s, len);
+        return dst + len;
+    }
+    *dst++ = '"';
+    for (; *s; ++s) {
+        if (*s == '"') *dst++ = '"';
+        *dst++ = *s;
+    }
+    *dst++ = '"';
+    return dst;
+}
+
+// one row; each field fits its Record buffer (at most OWNER_MAX_LEN bytes)
+void export_row(ExportWriter *w, const char *id, const char *reg, const char *owner, const char *date) {
+    if (w->cap - w->len < EXPORT_ROW_MAX) export_flush(w);
+    const char *fields[EXPORT_MAX_COLUMNS] = {id, reg, owner, date};
+    char *dst = w->buf + w->len;
+    if (w->format == EXPORT_NDJSON) *dst++ = '{';
+    for (int i = 0; i < w->ncolumns; ++i) {
+        int f = w->columns[i];
+        if (w->format == EXPORT_CSV) {
+            if (i) *dst++ = ',';
+            dst = export_csv_escape(dst, fields[f]);
+            continue;
+        }
+        if (i) *dst++ = ',';
+        *dst++ = '"';
+        size_t len = strlen(export_column_name(f));
+        memcpy(dst, export_column_name(f), len);
+        dst += len;
+        *dst++ = '"';
+        *dst++ = ':';
+        *dst++ = '"';
+        dst = export_json_escape(dst, fields[f]);
+        *dst++ = '"';
+    }
+    if (w->format == EXPORT_NDJSON) *dst++ = '}';
+    *dst++ = '\n';
+    w->len = (size_t)(dst - w->buf);
+    w->rows++;
+}
+
+// write what is buffered; returns rows exported, -1 if a write failed
+long export_end(ExportWriter *w) {
+    export_flush(w);
+    if (!w->failed && fflush(w->out) != 0) w->failed = 1;
+    return w->failed ? -1 : w->rows;
+}
+
+// rows of the store (all of them when rows is NULL) to out; -1 when out of memory or a write failed
+long export_store(const RecordStore *store, const int *rows, int n, FILE *out, int format, const int *columns,
+                  int ncolumns) {
+    char *buf = malloc(EXPORT_BUFFER_BYTES);
+    if (!buf) return -1;
+    ExportWriter w;
+    export_begin(&w, out, format, columns, ncolumns, buf, EXPORT_BUFFER_BYTES);
+    if (!rows) n = store->count;
+    for (int i = 0; i < n; ++i) {
+        int row = rows ? rows[i] : i;
+        const StoredRow *r = &store->rows[row];
+        export_row(&w, r->inspectionID, r->carReg, store_owner(store, row), r->date);
+    }
+    long written = export_end(&w);
+    free(buf);
+    return written;
+}
+
+/* ---------- Load generator (mixed workload against the store) ---------- */
+
+static const char *loadgen_op_names[LOADGEN_OPS] = {"lookup", "add", "update", "delete", "range"};
+
+// "L,A,U,D,R" weights of lookup, add, update, delete and range; 0 unless five
+// non-negative numbers with a positive sum
+int loadgen_parse_mix(const char *text, int mix[LOADGEN_OPS]) {
+    int w[LOADGEN_OPS], sum = 0;
+    const char *p = text;
+    for (int i = 0; i < LOADGEN_OPS; ++i) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v < 0 || v > 1000000) return 0;
+        w[i] = (int)v;
+        sum += w[i];
+        p = end;
+        if (i + 1 < LOADGEN_OPS && *p++ != ',') return 0;
+    }
+    if (*p || sum == 0) return 0;
+    memcpy(mix, w, sizeof(w));
+    return 1;
+}
+
+void loadgen_config_init(LoadgenConfig *c) {
+    memset(c, 0, sizeof(*c));
+    loadgen_parse_mix(LOADGEN_DEFAULT_MIX, c->mix);
+    c->workers = 1;
+    c->ops = LOADGEN_DEFAULT_OPS;
+    c->rows = LOADGEN_DEFAULT_ROWS;
+    c->seed = LOADGEN_DEFAULT_SEED;
+    snprintf(c->path, sizeof(c->path), "%s", LOADGEN_FILE);
+}
+
+// splitmix64: every worker's stream follows from the seed alone
+static uint64_t loadgen_rand(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void loadgen_slot_id(int slot, char *out) {
+    snprintf(out, ID_REG_BUFFER_LEN, "%c%03d", 'A' + slot / 999, slot % 999 + 1);
+}
+
+// InspectionID -> slot, or -1 when it is not A001..Z999
+static int loadgen_id_slot(const char *id) {
+    if (!is_valid_id(id)) return -1;
+    return (id[0] - 'A') * 999 + atoi(id + 1) - 1;
+}
+
+// a valid record for slot, the other fields drawn from rng
+static void loadgen_record(int slot, uint64_t *rng, Record *r) {
+    static const char *first[] = {"Somchai", "Malee", "Anan", "Kanya", "Niran", "Pim", "Jordan", "Minju"};
+    static const char *last[] = {"Jaidee", "Srisuk", "Wongsa", "Kim", "Park", "Lee", "Diaz", "Walker"};
+    memset(r, 0, sizeof(*r));
+    loadgen_slot_id(slot, r->inspectionID);
+    uint64_t v = loadgen_rand(rng);
+    snprintf(r->carReg, sizeof(r->carReg), "%c%c%c%04u", 'A' + (int)(v % 26), 'A' + (int)(v / 26 % 26),
+             'A' + (int)(v / 676 % 26), 1 + (unsigned)(v / 17576 % 9999));
+    v = loadgen_rand(rng);
+    snprintf(r->owner, sizeof(r->owner), "%s %s", first[v % 8], last[v / 8 % 8]);
+    v = loadgen_rand(rng);
+    snprintf(r->date, sizeof(r->date), "%02d/%02d/%04d", 1 + (int)(v % 28), 1 + (int)(v / 28 % 12),
+             MIN_YEAR + (int)(v / 336 % (MAX_YEAR - MIN_YEAR + 1)));
+}
+
+// whether slot holds a row before the run, and that row
+static int loadgen_initial(const LoadgenConfig *c, int slot, Record *r) {
+    uint64_t rng = c->seed ^ ((uint64_t)slot * 0xD1B54A32D192ED03ULL);
+    if ((int)(loadgen_rand(&rng) % INTEGRITY_ID_SLOTS) >= c->rows) return 0;
+    loadgen_record(slot, &rng, r);
+    return 1;
+}
+
+static int loadgen_records_equal(const Record *a, const Record *b) {
+    return strcmp(a->inspectionID, b->inspectionID) == 0 && strcmp(a->carReg, b->carReg) == 0 &&
+           strcmp(a->owner, b->owner) == 0 && strcmp(a->date, b->date) == 0;
+}
+
+// one worker's share of the keys: order[0..present) are the owned indexes holding a row,
+// the rest are free; where[] is each index's position in order
+typedef struct {
+    const LoadgenConfig *config;
+    int worker;
+    int owned; // slot = index * workers + worker
+    Record *rows;
+    int *order;
+    int *where;
+    int present;
+    uint64_t rng;
+} LoadgenModel;
+
+typedef struct {
+    int op; // LOADGEN_*, or -1 when skipped
+    int slot;
+    int expect; // the key held a row before the op
+    Record r; // lookup: the expected row; add / update: the new row
+    uint32_t from, to; // range: day numbers
+    char filter[INPUT_BUFFER_SIZE];
+} LoadgenOp;
+
+static void loadgen_model_free(LoadgenModel *m) {
+    free(m->rows);
+    free(m->order);
+    free(m->where);
+    memset(m, 0, sizeof(*m));
+}
+
+static int loadgen_model_init(LoadgenModel *m, const LoadgenConfig *c, int worker) {
+    memset(m, 0, sizeof(*m));
+    m->config = c;
+    m->worker = worker;
+    m->owned = (INTEGRITY_ID_SLOTS - worker + c->workers - 1) / c->workers;
+    m->rows = malloc(sizeof(Record) * (size_t)m->owned);
+    m->order = malloc(sizeof(int) * (size_t)m->owned);
+    m->where = malloc(sizeof(int) * (size_t)m->owned);
+    if (!m->rows || !m->order || !m->where) {
+        loadgen_model_free(m);
+        return 0;
+    }
+    int free_at = m->owned;
+    for (int j = 0; j < m->owned; ++j) {
+        int at = loadgen_initial(c, j * c->workers + worker, &m->rows[j]) ? m->present++ : --free_at;
+        m->order[at] = j;
+        m->where[j] = at;
+    }
+    m->rng = c->seed + 0x632BE59BD9B4E019ULL * (uint64_t)(worker + 1);
+    return 1;
+}
+
+static void loadgen_model_swap(LoadgenModel *m, int a, int b) {
+    int ja = m->order[a], jb = m->order[b];
+    m->order[a] = jb;
+    m->order[b] = ja;
+    m->where[jb] = a;
+    m->where[ja] = b;
+}
+
+// draw the next op and apply it to the model
+static void loadgen_model_next(LoadgenModel *m, LoadgenOp *op) {
+    const LoadgenConfig *c = m->config;
+    int total = 0;
+    for (int i = 0; i < LOADGEN_OPS; ++i) total += c->mix[i];
+    int pick = (int)(loadgen_rand(&m->rng) % (uint64_t)total);
+    op->op = 0;
+    while (pick >= c->mix[op->op]) pick -= c->mix[op->op++];
+    uint64_t v = loadgen_rand(&m->rng);
+    int j = -1;
+    switch (op->op) {
+        case LOADGEN_LOOKUP:
+            j = (int)(v % (uint64_t)m->owned);
+            break;
+        case LOADGEN_ADD:
+            if (m->present < m->owned) j = m->order[m->present + (int)(v % (uint64_t)(m->owned - m->present))];
+            break;
+        case LOADGEN_UPDATE:
+        case LOADGEN_DELETE:
+            if (m->present > 0) j = m->order[v % (uint64_t)m->present];
+            break;
+        case LOADGEN_RANGE: {
+            // windows stay inside MIN_YEAR..MAX_YEAR, where query dates are valid
+            long days = days_from_civil(MAX_YEAR, 12, 31) - days_from_civil(MIN_YEAR, 1, 1) + 1;
+            op->from = (uint32_t)(v % (uint64_t)(days - LOADGEN_RANGE_DAYS + 1));
+            op->to = op->from + LOADGEN_RANGE_DAYS - 1;
+            char a[DATE_BUFFER_LEN], b[DATE_BUFFER_LEN];
+            day_number_date(op->from, a);
+            day_number_date(op->to, b);
+            snprintf(op->filter, sizeof(op->filter), "date >= %s and date <= %s", a, b);
+            return;
+        }
+    }
+    if (j < 0) {
+        op->op = -1;
+        return;
+    }
+    op->slot = j * c->workers + m->worker;
+    op->expect = m->where[j] < m->present;
+    if (op->op == LOADGEN_LOOKUP) {
+        if (op->expect) op->r = m->rows[j];
+        return;
+    }
+    if (op->op == LOADGEN_DELETE) {
+        loadgen_model_swap(m, m->where[j], --m->present);
+        return;
+    }
+    loadgen_record(op->slot, &m->rng, &op->r);
+    m->rows[j] = op->r;
+    if (op->op == LOADGEN_ADD) loadgen_model_swap(m, m->where[j], m->present++);
+}
+
+// log-linear buckets: exact below 2^LOADGEN_LAT_SUB_BITS us, then that many per power of two
+static int loadgen_bucket(double us) {
+    uint64_t v = us < 1 ? 0 : (uint64_t)us;
+    int sub = 1 << LOADGEN_LAT_SUB_BITS;
+    if (v < (uint64_t)sub) return (int)v;
+    int e = LOADGEN_LAT_SUB_BITS;
+    while (e < 63 && (v >> (e + 1))) e++;
+    int b = (e - LOADGEN_LAT_SUB_BITS + 1) * sub + (int)((v >> (e - LOADGEN_LAT_SUB_BITS)) & (uint64_t)(sub - 1));
+    return b < LOADGEN_LAT_BUCKETS ? b : LOADGEN_LAT_BUCKETS - 1;
+}
+
+// upper edge of bucket b in microseconds
+static double loadgen_bucket_us(int b) {
+    int sub = 1 << LOADGEN_LAT_SUB_BITS;
+    if (b < sub) return b + 1;
+    int e = b / sub + LOADGEN_LAT_SUB_BITS - 1;
+    return (double)(sub + b % sub + 1) * (double)(1ULL << (e - LOADGEN_LAT_SUB_BITS));
+}
+
+// the p-th percentile (0..100) of op's latencies in microseconds; 0 with no samples
+double loadgen_percentile(const LoadgenStats *s, int op, double p) {
+    long n = 0;
+    for (int b = 0; b < LOADGEN_LAT_BUCKETS; ++b) n += s->latency[op][b];
+    if (n == 0) return 0;
+    long rank = (long)(p / 100.0 * n + 0.999999);
+    if (rank < 1) rank = 1;
+    long seen = 0;
+    for (int b = 0; b < LOADGEN_LAT_BUCKETS; ++b) {
+        seen += s->latency[op][b];
+        if (seen >= rank) {
+            double us = loadgen_bucket_us(b);
+            return us < s->max_us[op] ? us : s->max_us[op];
+        }
+    }
+    return s->max_us[op];
+}
+
+static void loadgen_fail(LoadgenStats *s, int op, const char *what, int slot) {
+    s->errors[op]++;
+    if (s->first_error[0]) return;
+    char id[ID_REG_BUFFER_LEN] = "";
+    if (slot >= 0) loadgen_slot_id(slot, id);
+    snprintf(s->first_error, sizeof(s->first_error), "%s %s%s%s", loadgen_op_names[op], id, slot >= 0 ? ": " : "", what);
+}
+
+typedef struct {
+    const LoadgenConfig *config;
+    RecordStore *store; // threads: the shared store, guarded by lock
+    pthread_rwlock_t lock;
+    char lock_path[MAX_LINE + 8]; // processes: serializes access to config->path
+} LoadgenRun;
+
+typedef struct {
+    LoadgenRun *run;
+    LoadgenModel model;
+    LoadgenStats *stats;
+    RecordStore own; // processes: this worker's copy of the file
+    int lock_fd;
+    Query query;
+    Arena arena;
+} LoadgenWorker;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+static int loadgen_file_lock(int fd, int type) {
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = (short)type;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) != 0) {
+        if (errno != EINTR) return 0;
+    }
+    return 1;
+}
+#endif
+
+// the store op must run against: the shared one under the lock, or our own brought in
+// line with the file under the file lock
+static RecordStore *loadgen_acquire(LoadgenWorker *w, int write) {
+    LoadgenRun *run = w->run;
+    if (!run->config->processes) {
+        if (write) pthread_rwlock_wrlock(&run->lock);
+        else pthread_rwlock_rdlock(&run->lock);
+        return run->store;
+    }
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (!loadgen_file_lock(w->lock_fd, write ? F_WRLCK : F_RDLCK)) return NULL;
+    store_load_path(&w->own, run->config->path);
+    return &w->own;
+#else
+    return NULL;
+#endif
+}
+
+// persist a change made under loadgen_acquire, then let the others in; 0 if the save failed
+static int loadgen_release(LoadgenWorker *w, int kind, const Record *r) {
+    LoadgenRun *run = w->run;
+    if (!run->config->processes) {
+        pthread_rwlock_unlock(&run->lock);
+        return 1;
+    }
+    int ok = 1;
+#if !defined(_WIN32) && !defined(_WIN64)
+    const char *path = run->config->path;
+    if (kind == PERSIST_ADD) {
+        char line[MAX_LINE];
+        int len = snprintf(line, sizeof(line), "%s,%s,%s,%s\n", r->inspectionID, r->carReg, r->owner, r->date);
+        FILE *f = fopen(path, "a");
+        long at = f && fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+        ok = at >= 0 && fputs(line, f) >= 0;
+        if (f && fclose(f) != 0) ok = 0;
+        if (ok) store_note_append(&w->own, path, line, (size_t)len, (unsigned long long)at);
+    } else if (kind >= 0) {
+        ok = store_save_path(&w->own, path, SAVE_NO_SYNC);
+    }
+    loadgen_file_lock(w->lock_fd, F_UNLCK);
+#else
+    (void)kind;
+    (void)r;
+#endif
+    return ok;
+}
+
+// a date-range query through the filter engine: every row returned must be in the window,
+// and the rows of this worker's slots must be exactly the model's
+static void loadgen_check_range(LoadgenWorker *w, const RecordStore *store, const LoadgenOp *op) {
+    LoadgenModel *m = &w->model;
+    int workers = m->config->workers;
+    arena_reset(&w->arena);
+    int *rows;
+    int n = query_compile(&w->query, op->filter) ? query_collect(&w->query, store, &w->arena, &rows) : -1;
+    if (n < 0) {
+        loadgen_fail(w->stats, LOADGEN_RANGE, "query failed", -1);
+        return;
+    }
+    int mine = 0, expect = 0;
+    for (int i = 0; i < n; ++i) {
+        const StoredRow *s = &store->rows[rows[i]];
+        uint32_t day = store->day_keys[rows[i]];
+        if (day < op->from || day > op->to) {
+            loadgen_fail(w->stats, LOADGEN_RANGE, "row outside the window", loadgen_id_slot(s->inspectionID));
+            return;
+        }
+        int slot = loadgen_id_slot(s->inspectionID);
+        if (slot < 0 || slot % workers != m->worker) continue;
+        int j = slot / workers;
+        Record r;
+        store_get(store, rows[i], &r);
+        if (m->where[j] >= m->present || !loadgen_records_equal(&r, &m->rows[j])) {
+            loadgen_fail(w->stats, LOADGEN_RANGE, "row differs from the model", slot);
+            return;
+        }
+        mine++;
+    }
+    for (int i = 0; i < m->present; ++i) {
+        uint32_t day = date_day_number(m->rows[m->order[i]].date);
+        if (day >= op->from && day <= op->to) expect++;
+    }
+    if (mine != expect) {
+        char what[INPUT_BUFFER_SIZE];
+        snprintf(what, sizeof(what), "%d of the model's %d rows for '%.60s'", mine, expect, op->filter);
+        loadgen_fail(w->stats, LOADGEN_RANGE, what, -1);
+    }
+}
+
+// run op against the store and check the answer
+static void loadgen_execute(LoadgenWorker *w, const LoadgenOp *op) {
+    LoadgenStats *s = w->stats;
+    int write = op->op != LOADGEN_LOOKUP && op->op != LOADGEN_RANGE;
+    RecordStore *store = loadgen_acquire(w, write);
+    if (!store) {
+        loadgen_fail(s, op->op, "cannot lock the shared file", op->slot);
+        return;
+    }
+    if (op->op == LOADGEN_RANGE) {
+        loadgen_check_range(w, store, op);
+        loadgen_release(w, -1, NULL);
+        return;
+    }
+    char id[ID_REG_BUFFER_LEN];
+    loadgen_slot_id(op->slot, id);
+    int idx = store_find_key(store, id), kind = -1;
+    if ((idx >= 0) != op->expect) {
+        loadgen_fail(s, op->op, op->expect ? "key not found" : "key found after delete", op->slot);
+    } else if (op->op == LOADGEN_LOOKUP) {
+        Record r;
+        if (idx >= 0) store_get(store, idx, &r);
+        if (idx >= 0 && !loadgen_records_equal(&r, &op->r)) loadgen_fail(s, op->op, "row differs from the model", op->slot);
+    } else if (op->op == LOADGEN_ADD) {
+        if (store_append(store, &op->r)) kind = PERSIST_ADD;
+        else loadgen_fail(s, op->op, "out of memory", op->slot);
+    } else if (op->op == LOADGEN_UPDATE) {
+        if (store_set(store, idx, &op->r)) kind = PERSIST_SET;
+        else loadgen_fail(s, op->op, "out of memory", op->slot);
+    } else {
+        store_remove(store, idx);
+        kind = PERSIST_REMOVE;
+    }
+    if (!loadgen_release(w, kind, &op->r)) loadgen_fail(s, op->op, "cannot save the shared file", op->slot);
+}
+
+static void loadgen_worker_run(LoadgenWorker *w) {
+    const LoadgenConfig *c = w->run->config;
+    LoadgenStats *s = w->stats;
+    // paced runs time each op from when it was due, so a stall counts against every op
+    // queued behind it instead of only the one that hit it
+    double interval = c->rate > 0 ? 1000.0 * c->workers / c->rate : 0;
+    double start = now_ms();
+    for (long k = 0; k < c->ops; ++k) {
+        LoadgenOp op;
+        loadgen_model_next(&w->model, &op);
+        if (op.op < 0) {
+            s->skipped++;
+            continue;
+        }
+        double t0 = now_ms();
+        if (interval > 0) {
+            double due = start + k * interval;
+            if (due > t0) {
+                sleep_ms(due - t0);
+                t0 = now_ms();
+            } else {
+                t0 = due;
+            }
+        }
+        loadgen_execute(w, &op);
+        double us = (now_ms() - t0) * 1000.0;
+        s->count[op.op]++;
+        s->latency[op.op][loadgen_bucket(us)]++;
+        if (us > s->max_us[op.op]) s->max_us[op.op] = us;
+    }
+    s->ms = now_ms() - start;
+}
+
+static int loadgen_worker_init(LoadgenWorker *w, LoadgenRun *run, int index, LoadgenStats *stats) {
+    memset(w, 0, sizeof(*w));
+    w->run = run;
+    w->stats = stats;
+    w->lock_fd = -1;
+    store_init(&w->own);
+    arena_init(&w->arena);
+    return loadgen_model_init(&w->model, run->config, index);
+}
+
+static void loadgen_worker_free(LoadgenWorker *w) {
+    loadgen_model_free(&w->model);
+    store_free(&w->own);
+    arena_free(&w->arena);
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (w->lock_fd >= 0) close(w->lock_fd);
+#endif
+}
+
+static void *loadgen_thread(void *arg) {
+    loadgen_worker_run(arg);
+    return NULL;
+}
+
+// replay every worker's model without the store and compare it with store row by row;
+// returns the number of rows missing, extra or different, -1 when out of memory
+static long loadgen_final_check(const LoadgenConfig *c, const RecordStore *store, LoadgenStats *total) {
+    long diffs = 0;
+    unsigned char *seen = calloc(INTEGRITY_ID_SLOTS, 1);
+    if (!seen) return -1;
+    for (int w = 0; w < c->workers; ++w) {
+        LoadgenModel m;
+        if (!loadgen_model_init(&m, c, w)) {
+            free(seen);
+            return -1;
+        }
+        LoadgenOp op;
+        for (long k = 0; k < c->ops; ++k) loadgen_model_next(&m, &op);
+        for (int i = 0; i < store->count; ++i) {
+            int slot = loadgen_id_slot(store->rows[i].inspectionID);
+            if (slot >= 0 && slot % c->workers != w) continue;
+            Record r;
+            store_get(store, i, &r);
+            int j = slot >= 0 ? slot / c->workers : -1;
+            if (j < 0 || seen[slot] || m.where[j] >= m.present || !loadgen_records_equal(&r, &m.rows[j])) {
+                if (!total->first_error[0]) {
+                    snprintf(total->first_error, sizeof(total->first_error), "final state: row %s,%s,%s,%s %s",
+                             r.inspectionID, r.carReg, r.owner, r.date,
+                             j < 0 ? "has no valid key" : seen[slot] ? "is a duplicate" : "is not in the model");
+                }
+                diffs++;
+                if (slot >= 0 && !seen[slot]) seen[slot] = 2; // kept apart from the matches below
+                continue;
+            }
+            seen[slot] = 1;
+        }
+        for (int i = 0; i < m.present; ++i) {
+            int slot = m.order[i] * c->workers + w;
+            if (seen[slot] == 1) continue;
+            if (!total->first_error[0]) {
+                char id[ID_REG_BUFFER_LEN];
+                loadgen_slot_id(slot, id);
+                snprintf(total->first_error, sizeof(total->first_error), "final state: %s is missing", id);
+            }
+            if (!seen[slot]) diffs++;
+        }
+        loadgen_model_free(&m);
+    }
+    free(seen);
+    return diffs;
+}
+
+static void loadgen_merge(LoadgenStats *total, const LoadgenStats *s) {
+    for (int op = 0; op < LOADGEN_OPS; ++op) {
+        total->count[op] += s->count[op];
+        total->errors[op] += s->errors[op];
+        for (int b = 0; b < LOADGEN_LAT_BUCKETS; ++b) total->latency[op][b] += s->latency[op][b];
+        if (s->max_us[op] > total->max_us[op]) total->max_us[op] = s->max_us[op];
+    }
+    total->skipped += s->skipped;
+    if (!total->first_error[0]) memcpy(total->first_error, s->first_error, sizeof(total->first_error));
+}
+
+// the store every worker starts from
+static int loadgen_initial_store(const LoadgenConfig *c, RecordStore *store) {
+    Record r;
+    for (int slot = 0; slot < INTEGRITY_ID_SLOTS; ++slot) {
+        if (loadgen_initial(c, slot, &r) && !store_append(store, &r)) return 0;
+    }
+    return 1;
+}
+
+static int loadgen_run_threads(LoadgenRun *run, LoadgenStats *stats, LoadgenStats *total) {
+    const LoadgenConfig *c = run->config;
+    RecordStore store;
+    store_init(&store);
+    LoadgenWorker *workers = calloc((size_t)c->workers, sizeof(LoadgenWorker));
+    pthread_t threads[LOADGEN_MAX_WORKERS];
+    int ready = 0, ok = workers && loadgen_initial_store(c, &store);
+    for (; ok && ready < c->workers; ++ready) {
+        if (!loadgen_worker_init(&workers[ready], run, ready, &stats[ready])) {
+            loadgen_worker_free(&workers[ready]);
+            ok = 0;
+            break;
+        }
+    }
+    if (ok) {
+        run->store = &store;
+        pthread_rwlock_init(&run->lock, NULL);
+        double t0 = now_ms();
+        int started = 0;
+        for (; started < c->workers; ++started) {
+            if (pthread_create(&threads[started], NULL, loadgen_thread, &workers[started]) != 0) break;
+        }
+        for (int i = 0; i < started; ++i) pthread_join(threads[i], NULL);
+        total->ms = now_ms() - t0;
+        pthread_rwlock_destroy(&run->lock);
+        ok = started == c->workers;
+        for (int i = 0; i < started; ++i) loadgen_merge(total, &stats[i]);
+        total->final_rows = store.count;
+        total->final_diffs = ok ? loadgen_final_check(c, &store, total) : 0;
+        if (total->final_diffs < 0) ok = 0;
+    }
+    for (int i = 0; i < ready; ++i) loadgen_worker_free(&workers[i]);
+    free(workers);
+    store_free(&store);
+    return ok;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+static int loadgen_read_all(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int loadgen_write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// the child side of a process worker: run, send the stats up the pipe, exit.
+// The store here never reaches PARALLEL_SCAN_THRESHOLD rows (there are only
+// INTEGRITY_ID_SLOTS keys), so nothing touches the scan pool the parent may have forked with
+static void loadgen_child(LoadgenRun *run, int index, LoadgenStats *stats, int fd) {
+    LoadgenWorker w;
+    int ok = loadgen_worker_init(&w, run, index, stats);
+    if (ok) {
+        w.lock_fd = open(run->lock_path, O_RDWR | O_CREAT, 0644);
+        ok = w.lock_fd >= 0;
+    }
+    if (ok) loadgen_worker_run(&w);
+    loadgen_worker_free(&w);
+    ok = ok && loadgen_write_all(fd, stats, sizeof(*stats));
+    close(fd);
+    _exit(ok ? 0 : 1);
+}
+#endif
+
+static int loadgen_run_processes(LoadgenRun *run, LoadgenStats *stats, LoadgenStats *total) {
+#if defined(_WIN32) || defined(_WIN64)
+    (void)run;
+    (void)stats;
+    (void)total;
+    return 0; // needs fork()
+#else
+    const LoadgenConfig *c = run->config;
+    snprintf(run->lock_path, sizeof(run->lock_path), "%s.lock", c->path);
+    RecordStore store;
+    store_init(&store);
+    int ok = loadgen_initial_store(c, &store) && store_save_path(&store, c->path, SAVE_NO_SYNC);
+    store_free(&store);
+    if (!ok) return 0;
+    pid_t pids[LOADGEN_MAX_WORKERS];
+    int fds[LOADGEN_MAX_WORKERS], started = 0;
+    double t0 = now_ms();
+    for (; started < c->workers; ++started) {
+        int p[2];
+        if (pipe(p) != 0) break;
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(p[0]);
+            close(p[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(p[0]);
+            for (int i = 0; i < started; ++i) close(fds[i]);
+            loadgen_child(run, started, &stats[started], p[1]);
+        }
+        close(p[1]);
+        pids[started] = pid;
+        fds[started] = p[0];
+    }
+    ok = started == c->workers;
+    for (int i = 0; i < started; ++i) {
+        int status = 0;
+        if (!loadgen_read_all(fds[i], &stats[i], sizeof(stats[i]))) ok = 0;
+        close(fds[i]);
+        while (waitpid(pids[i], &status, 0) < 0 && errno == EINTR) {}
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = 0;
+    }
+    total->ms = now_ms() - t0;
+    if (ok) {
+        for (int i = 0; i < started; ++i) loadgen_merge(total, &stats[i]);
+        store_init(&store);
+        total->final_rows = store_load_path(&store, c->path);
+        total->final_diffs = loadgen_final_check(c, &store, total);
+        if (total->final_diffs < 0) ok = 0;
+        store_free(&store);
+    }
+    remove(c->path);
+    remove(run->lock_path);
+    return ok;
+#endif
+}
+
+// run c and sum what the workers saw into total; 0 when the run could not be set up
+// (a run that ran reports its disagreements in total->errors and total->final_diffs)
+int loadgen_run(const LoadgenConfig *c, LoadgenStats *total) {
+    memset(total, 0, sizeof(*total));
+    if (c->workers < 1 || c->workers > LOADGEN_MAX_WORKERS || c->ops < 0) return 0;
+    LoadgenStats *stats = calloc((size_t)c->workers, sizeof(LoadgenStats));
+    if (!stats) return 0;
+    LoadgenRun run;
+    memset(&run, 0, sizeof(run));
+    run.config = c;
+    int ok = c->processes ? loadgen_run_processes(&run, stats, total) : loadgen_run_threads(&run, stats, total);
+    free(stats);
+    return ok;
+}
+
+long loadgen_error_count(const LoadgenStats *s) {
+    long n = s->final_diffs;
+    for (int op = 0; op < LOADGEN_OPS; ++op) n += s->errors[op];
+    return n;
+}
+
+void print_loadgen_report(const LoadgenConfig *c, const LoadgenStats *s, FILE *out) {
+    long ops = 0;
+    for (int op = 0; op < LOADGEN_OPS; ++op) ops += s->count[op];
+    double secs = s->ms > 0 ? s->ms / 1000.0 : 1e-9;
+    fprintf(out, "%d %s, %ld ops each, mix=%d,%d,%d,%d,%d, %d rows to start, seed=%llu, ", c->workers,
+            c->processes ? "process(es) sharing one file" : "thread(s) sharing one store", c->ops, c->mix[0],
+            c->mix[1], c->mix[2], c->mix[3], c->mix[4], c->rows, c->seed);
+    if (c->rate > 0) fprintf(out, "target %.0f ops/s\n", c->rate);
+    else fprintf(out, "unthrottled\n");
+    fprintf(out, "%-8s | %9s | %10s | %9s | %9s | %9s | %9s | %9s | %s\n", "Op", "count", "ops/s", "p50 us",
+            "p90 us", "p99 us", "p99.9 us", "max us", "errors");
+    fprintf(out, "%s\n", TABLE_SEPARATOR);
+    for (int op = 0; op < LOADGEN_OPS; ++op) {
+        if (!s->count[op]) continue;
+        fprintf(out, "%-8s | %9ld | %10.0f | %9.0f | %9.0f | %9.0f | %9.0f | %9.0f | %ld\n", loadgen_op_names[op],
+                s->count[op], s->count[op] / secs, loadgen_percentile(s, op, 50), loadgen_percentile(s, op, 90),
+                loadgen_percentile(s, op, 99), loadgen_percentile(s, op, 99.9), s->max_us[op], s->errors[op]);
+    }
+    fprintf(out, "%s\n", TABLE_SEPARATOR);
+    fprintf(out, "%ld ops in %.0f ms: %.0f ops/s", ops, s->ms, ops / secs);
+    if (s->skipped) fprintf(out, " (%ld skipped: no key free to add, or none left to change)", s->skipped);
+    fprintf(out, "\nFinal state: %d rows, %ld differ from the reference model.\n", s->final_rows, s->final_diffs);
+    long errors = loadgen_error_count(s);
+    if (errors) fprintf(out, "FAILED: %ld disagreement(s); first: %s\n", errors, s->first_error);
+    else fprintf(out, "Every answer matched the reference model.\n");
+}
+
+/* ---------- Public API (inspection_engine.h) ---------- */
+
+// InspectionRecord is handed out as a copy of a Record, so the two must stay the same shape
+_Static_assert(sizeof(InspectionRecord) == sizeof(Record) && INSPECTION_ID_LEN == ID_REG_BUFFER_LEN &&
+                   INSPECTION_CAR_REG_LEN == CAR_REG_BUFFER_LEN && INSPECTION_OWNER_LEN == OWNER_BUFFER_LEN &&
+                   INSPECTION_DATE_LEN == DATE_BUFFER_LEN,
+               "InspectionRecord must match Record");
+
+// A handle keeps its rows twice. Writers (load included) take the lock and work on the
+// RecordStore, which holds the file's sync state and the key columns clash checks use,
+// then publish the change to the snapshot store. Readers pin the current snapshot and
+// never wait for a writer, nor a writer for them: a long query or iterate sees the rows as
+// they were when it began. stale is set when a publish ran out of memory; the next call
+// copies every row again
+struct InspectionStore {
+    RecordStore store;
+    MvccStore snap;
+    pthread_mutex_t lock;
+    atomic_int stale;
+    char path[MAX_LINE];
+};
+
+// replace the snapshot with every row of the store; 0 when out of memory
+static int inspection_republish(InspectionStore *h) {
+    const RecordStore *st = &h->store;
+    Record *rows = malloc(sizeof(Record) * (size_t)(st->count > 0 ? st->count : 1));
+    int ok = rows != NULL;
+    for (int i = 0; ok && i < st->count; ++i) store_get(st, i, &rows[i]);
+    ok = ok && mvcc_load(&h->snap, rows, st->count);
+    free(rows);
+    atomic_store(&h->stale, !ok);
+    return ok;
+}
+
+// show readers a change the store and the file already have (row as for write_behind_push)
+static void inspection_publish(InspectionStore *h, int kind, int row, const Record *r) {
+    int ok = !atomic_load(&h->stale);
+    if (ok && kind == PERSIST_ADD) ok = mvcc_append(&h->snap, r);
+    else if (ok && kind == PERSIST_SET) ok = mvcc_update(&h->snap, row, r);
+    else if (ok) ok = mvcc_remove(&h->snap, row);
+    if (!ok) inspection_republish(h);
+}
+
+// pick up the file; a missing one is an empty store (the first add creates it). A load
+// that only read an appended tail publishes those rows, anything else all of them
+static int inspection_sync(InspectionStore *h) {
+    int had = h->store.count;
+    long full_loads = h->store.csv.full_loads;
+    int n = store_load_path(&h->store, h->path);
+    int err = h->store.csv.error;
+    if (h->store.csv.full_loads != full_loads || n - had > MVCC_CHUNK_ROWS || atomic_load(&h->stale)) {
+        inspection_republish(h);
+    } else {
+        Record r;
+        for (int i = had; i < n; ++i) {
+            store_get(&h->store, i, &r);
+            if (!mvcc_append(&h->snap, &r)) {
+                inspection_republish(h);
+                break;
+            }
+        }
+    }
+    if (err == ENOMEM || atomic_load(&h->stale)) return INSPECTION_NO_MEMORY;
+    if (err && err != ENOENT) return INSPECTION_IO;
+    return n;
+}
+
+// the rows as of now for one read: a pinned snapshot, or, with MVCC_MAX_READERS readers
+// already in, the current one held still by taking the writers' lock (*slot = -1).
+// NULL when a stale snapshot cannot be refreshed
+static const MvccVersion *inspection_read_begin(InspectionStore *h, int *slot) {
+    if (atomic_load(&h->stale)) {
+        pthread_mutex_lock(&h->lock);
+        int ok = !atomic_load(&h->stale) || inspection_republish(h);
+        pthread_mutex_unlock(&h->lock);
+        if (!ok) return NULL;
+    }
+    *slot = mvcc_register(&h->snap);
+    if (*slot >= 0) return mvcc_pin(&h->snap, *slot);
+    pthread_mutex_lock(&h->lock);
+    return atomic_load(&h->snap.current);
+}
+
+static void inspection_read_end(InspectionStore *h, int slot) {
+    if (slot >= 0) mvcc_unregister(&h->snap, slot);
+    else pthread_mutex_unlock(&h->lock);
+}
+
+// pass n rows of v (the first n when rows is NULL) to fn as copies until it asks to stop;
+// returns how many it saw
+static int inspection_emit(const MvccVersion *v, const int *rows, int n, InspectionRecordFn fn, void *ctx) {
+    if (!fn) return n;
+    for (int i = 0; i < n; ++i) {
+        InspectionRecord r;
+        memcpy(&r, mvcc_row(v, rows ? rows[i] : i), sizeof(r));
+        if (fn(&r, ctx)) return i + 1;
+    }
+    return n;
+}
+
+typedef struct {
+    const MvccVersion *v;
+    const char *key;
+    const Query *q;
+} SnapshotScanCtx;
+
+static int snapshot_row_matches(int row, void *ctx) {
+    const SnapshotScanCtx *c = ctx;
+    return query_record_matches(c->q, mvcc_row(c->v, row));
+}
+
+// the snapshot's rows with c->key (through its key filter and key columns) or matching
+// pred, in order, then passed to fn; a large snapshot is split over the scan pool
+static int inspection_scan(InspectionStore *h, RowPredicate pred, SnapshotScanCtx *c, InspectionRecordFn fn,
+                           void *ctx) {
+    int slot;
+    if (!(c->v = inspection_read_begin(h, &slot))) return INSPECTION_NO_MEMORY;
+    Arena arena;
+    arena_init(&arena);
+    int count = mvcc_count(c->v), *rows, n;
+    if (c->key) n = mvcc_collect_key(c->v, c->key, &arena, &rows);
+    else n = parallel_collect(count > PARALLEL_SCAN_THRESHOLD ? scan_pool() : NULL, count, pred, c, &arena, &rows);
+    n = n < 0 ? INSPECTION_NO_MEMORY : inspection_emit(c->v, rows, n, fn, ctx);
+    inspection_read_end(h, slot);
+    arena_free(&arena);
+    return n;
+}
+
+// row whose InspectionID is id (case-insensitive); -1 when there is none, -2 out of memory
+static int inspection_find_id(const RecordStore *store, const char *id) {
+    Arena arena;
+    arena_init(&arena);
+    int *rows;
+    int n = store_collect_key(store, id, &arena, &rows), found = n < 0 ? -2 : -1;
+    for (int i = 0; i < n && found < 0; ++i) {
+        if (strcasecmp(store->rows[rows[i]].inspectionID, id) == 0) found = rows[i];
+    }
+    arena_free(&arena);
+    return found;
+}
+
+// the checks of the console's add form, on r copied into out with its date normalized
+static int inspection_validate(const InspectionRecord *r, Record *out) {
+    if (!r || !memchr(r->inspectionID, '\0', sizeof(r->inspectionID)) || !memchr(r->carReg, '\0', sizeof(r->carReg)) ||
+        !memchr(r->owner, '\0', sizeof(r->owner)) || !memchr(r->date, '\0', sizeof(r->date))) {
+        return INSPECTION_INVALID;
+    }
+    memcpy(out, r, sizeof(*out));
+    if (!is_valid_id(out->inspectionID) || !is_valid_car_reg(out->carReg) || !is_valid_owner_name(out->owner) ||
+        !is_valid_date(r->date, out->date)) {
+        return INSPECTION_INVALID;
+    }
+    return INSPECTION_OK;
+}
+
+// write a change already made in the store (row as for write_behind_push): adds are
+// appended and flushed, anything else replaces the file with a synced rewrite; then
+// readers see it. On failure the store goes back to what the file holds
+static int inspection_persist(InspectionStore *h, int kind, int row, const Record *r) {
+    int ok;
+    if (kind == PERSIST_ADD) {
+        char line[MAX_LINE];
+        int len = snprintf(line, sizeof(line), "%s,%s,%s,%s\n", r->inspectionID, r->carReg, r->owner, r->date);
+        unsigned long long at;
+        ok = file_append_sync(h->path, line, (size_t)len, &at);
+        if (ok && at == 0) ok = dir_sync(h->path); // the add created the file
+        if (ok) store_note_append(&h->store, h->path, line, (size_t)len, at);
+    } else {
+        ok = store_save_path(&h->store, h->path, SAVE_SYNC_ALL);
+    }
+    if (!ok) {
+        inspection_sync(h);
+        return INSPECTION_IO;
+    }
+    disk_index_refresh(h->path, kind != PERSIST_ADD);
+    inspection_publish(h, kind, row, r);
+    return INSPECTION_OK;
+}
+
+InspectionStore *inspection_open(const char *path, int *status) {
+    InspectionStore *h = NULL;
+    int rc = INSPECTION_INVALID;
+    if (path && strlen(path) < sizeof(h->path)) {
+        h = malloc(sizeof(*h));
+        rc = h ? INSPECTION_OK : INSPECTION_NO_MEMORY;
+    }
+    if (h) {
+        snprintf(h->path, sizeof(h->path), "%s", path);
+        store_init(&h->store);
+        mvcc_init(&h->snap);
+        pthread_mutex_init(&h->lock, NULL);
+        atomic_init(&h->stale, 0);
+        rc = inspection_sync(h);
+        if (rc < 0) {
+            inspection_close(h);
+            h = NULL;
+        }
+    }
+    if (status) *status = rc < 0 ? rc : INSPECTION_OK;
+    return h;
+}
+
+int inspection_load(InspectionStore *h) {
+    if (!h) return INSPECTION_INVALID;
+    pthread_mutex_lock(&h->lock);
+    int n = inspection_sync(h);
+    pthread_mutex_unlock(&h->lock);
+    return n;
+}
+
+int inspection_count(InspectionStore *h) {
+    if (!h) return INSPECTION_INVALID;
+    int slot;
+    const MvccVersion *v = inspection_read_begin(h, &slot);
+    if (!v) return INSPECTION_NO_MEMORY;
+    int n = mvcc_count(v);
+    inspection_read_end(h, slot);
+    return n;
+}
+
+int inspection_lookup(InspectionStore *h, const char *key, InspectionRecordFn fn, void *ctx) {
+    if (!h || !key) return INSPECTION_INVALID;
+    SnapshotScanCtx c = {NULL, key, NULL};
+    return inspection_scan(h, NULL, &c, fn, ctx);
+}
+
+int inspection_query(InspectionStore *h, const char *filter, InspectionRecordFn fn, void *ctx, char *err,
+                     size_t err_size) {
+    if (err && err_size) err[0] = '\0';
+    if (!h || !filter) return INSPECTION_INVALID;
+    Query *q = malloc(sizeof(Query));
+    if (!q) return INSPECTION_NO_MEMORY;
+    if (!query_compile(q, filter)) {
+        if (err && err_size) snprintf(err, err_size, "%s", q->error);
+        free(q);
+        return INSPECTION_BAD_QUERY;
+    }
+    SnapshotScanCtx c = {NULL, NULL, q};
+    int n = inspection_scan(h, snapshot_row_matches, &c, fn, ctx);
+    free(q);
+    return n;
+}
+
+int inspection_iterate(InspectionStore *h, InspectionRecordFn fn, void *ctx) {
+    if (!h) return INSPECTION_INVALID;
+    int slot;
+    const MvccVersion *v = inspection_read_begin(h, &slot);
+    if (!v) return INSPECTION_NO_MEMORY;
+    int n = inspection_emit(v, NULL, mvcc_count(v), fn, ctx);
+    inspection_read_end(h, slot);
+    return n;
+}
+
+int inspection_add(InspectionStore *h, const InspectionRecord *r) {
+    Record rec;
+    if (!h || inspection_validate(r, &rec) != INSPECTION_OK) return INSPECTION_INVALID;
+    pthread_mutex_lock(&h->lock);
+    int rc = inspection_sync(h); // see rows other processes added before checking for a clash
+    if (rc >= 0) {
+        if (store_find_key(&h->store, rec.inspectionID) != -1) rc = INSPECTION_DUPLICATE;
+        else if (!store_append(&h->store, &rec)) rc = INSPECTION_NO_MEMORY;
+        else rc = inspection_persist(h, PERSIST_ADD, h->store.count - 1, &rec);
+    }
+    pthread_mutex_unlock(&h->lock);
+    return rc < 0 ? rc : INSPECTION_OK;
+}
+
+int inspection_update(InspectionStore *h, const char *id, const InspectionRecord *r) {
+    Record rec;
+    if (!h || !id || inspection_validate(r, &rec) != INSPECTION_OK) return INSPECTION_INVALID;
+    pthread_mutex_lock(&h->lock);
+    int rc = inspection_sync(h);
+    int row = rc < 0 ? -1 : inspection_find_id(&h->store, id);
+    if (rc >= 0) rc = row == -2 ? INSPECTION_NO_MEMORY : row < 0 ? INSPECTION_NOT_FOUND : INSPECTION_OK;
+    if (rc == INSPECTION_OK && strcasecmp(rec.inspectionID, id) != 0) {
+        // a new ID must not already be an ID or plate on another row
+        int clash = store_find_key(&h->store, rec.inspectionID);
+        if (clash != -1 && clash != row) rc = INSPECTION_DUPLICATE;
+    }
+    if (rc == INSPECTION_OK) {
+        rc = store_set(&h->store, row, &rec) ? inspection_persist(h, PERSIST_SET, row, &rec) : INSPECTION_NO_MEMORY;
+    }
+    pthread_mutex_unlock(&h->lock);
+    return rc;
+}
+
+int inspection_delete(InspectionStore *h, const char *id) {
+    if (!h || !id) return INSPECTION_INVALID;
+    pthread_mutex_lock(&h->lock);
+    int rc = inspection_sync(h);
+    int row = rc < 0 ? -1 : inspection_find_id(&h->store, id);
+    if (rc >= 0) rc = row == -2 ? INSPECTION_NO_MEMORY : row < 0 ? INSPECTION_NOT_FOUND : INSPECTION_OK;
+    if (rc == INSPECTION_OK) {
+        Record old;
+        store_get(&h->store, row, &old);
+        store_remove(&h->store, row);
+        rc = inspection_persist(h, PERSIST_REMOVE, row, &old);
+    }
+    pthread_mutex_unlock(&h->lock);
+    return rc;
+}
+
+// no other call on h may be running
+void inspection_close(InspectionStore *h) {
+    if (!h) return;
+    store_free(&h->store);
+    mvcc_free(&h->snap);
+    pthread_mutex_destroy(&h->lock);
+    free(h);
+}
+
+const char *inspection_strerror(int status) {
+    switch (status) {
+        case INSPECTION_NOT_FOUND:
+            return "no record has that InspectionID";
+        case INSPECTION_DUPLICATE:
+            return "the InspectionID is already on file";
+        case INSPECTION_INVALID:
+            return "invalid record or argument";
+        case INSPECTION_NO_MEMORY:
+            return "out of memory";
+        case INSPECTION_IO:
+            return "cannot read or write the data file";
+        case INSPECTION_BAD_QUERY:
+            return "not a valid filter";
+    }
+    return status >= 0 ? "ok" : "unknown error";
+}
@@ -0,0 +1,123 @@
+#ifndef INSPECTION_ENGINE_H
+#define INSPECTION_ENGINE_H
+
+// Public C API of the inspection engine (inspection_engine.c), for programs that link
+// the engine in-process instead of running the console app per query.
+//
+// The handle is opaque and carries its own lock: any number of threads may share one
+// InspectionStore. Lookups, queries and iteration read a snapshot of the rows and never
+// wait for writers; add, update, delete and load take turns and publish a new snapshot
+// when they succeed. Open one handle per file and share it.
+// Every change is on disk (flushed) before its call returns. No call prints or reads
+// the console.
+//
+// Records are handed to callbacks as copies taken from the snapshot the call started
+// with; changes made meanwhile show up in later calls. A callback must not call back
+// into the same handle: with every snapshot reader slot taken, the call falls back to
+// holding the handle's lock.
+//
+// Handles are independent, but the engine keeps some process-wide state that all of
+// them share. This header has no way to change it; a program that also uses the
+// internal API in Project.h (as the console app does) must leave it alone while any
+// call on any handle may be running:
+//   - key filter settings (key_filter_config()): read whenever a handle rebuilds one of
+//     its key filters (the writers' and the snapshot's lookups use) or its on-disk index,
+//     i.e. on open, load and the adds and updates that outgrow them. The counters in it
+//     are atomics and may be read at any time.
+//   - the shared scan pool (scan_pool()): created once, used by every handle's large
+//     lookups and queries; safe from any thread.
+// The search cache size is engine state too, but handles never read it. The console's
+// save modes, partitioned layout and integrity options are not in the engine at all. A
+// handle always reads and writes the one CSV file it was opened on.
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INSPECTION_API_VERSION 1
+
+// Marks the functions below as the library's only exports. Build the engine with
+// -fvisibility=hidden (a Windows DLL with -DINSPECTION_BUILD_DLL) so that none of its
+// internals can clash with the host program's symbols; programs that link the DLL
+// define INSPECTION_USE_DLL.
+#if defined(_WIN32) && defined(INSPECTION_BUILD_DLL)
+#define INSPECTION_EXPORT __declspec(dllexport)
+#elif defined(_WIN32) && defined(INSPECTION_USE_DLL)
+#define INSPECTION_EXPORT __declspec(dllimport)
+#elif defined(__GNUC__) && !defined(_WIN32)
+#define INSPECTION_EXPORT __attribute__((visibility("default")))
+#else
+#define INSPECTION_EXPORT
+#endif
+
+// Status codes: 0 or a count on success, one of these (< 0) on failure
+#define INSPECTION_OK 0
+#define INSPECTION_NOT_FOUND (-1) // no record has that InspectionID
+#define INSPECTION_DUPLICATE (-2) // the InspectionID is already an ID or plate on file
+#define INSPECTION_INVALID (-3) // a field failed validation, or a NULL argument
+#define INSPECTION_NO_MEMORY (-4)
+#define INSPECTION_IO (-5) // the data file could not be read or written; see errno
+#define INSPECTION_BAD_QUERY (-6) // the filter did not compile; see the error text
+
+// Field buffer sizes, terminator included (the same as the console app's)
+#define INSPECTION_ID_LEN 17
+#define INSPECTION_CAR_REG_LEN 14
+#define INSPECTION_OWNER_LEN 41
+#define INSPECTION_DATE_LEN 15
+
+typedef struct InspectionStore InspectionStore;
+
+typedef struct {
+    char inspectionID[INSPECTION_ID_LEN];
+    char carReg[INSPECTION_CAR_REG_LEN];
+    char owner[INSPECTION_OWNER_LEN];
+    char date[INSPECTION_DATE_LEN]; // DD/MM/YYYY
+} InspectionRecord;
+
+// called once per record; return nonzero to stop early
+typedef int (*InspectionRecordFn)(const InspectionRecord *r, void *ctx);
+
+// Open a handle on the CSV file at path and load it. A missing file opens empty and is
+// created by the first add. Returns NULL on failure, with the status in *status if given.
+INSPECTION_EXPORT InspectionStore *inspection_open(const char *path, int *status);
+
+// Pick up changes other processes made to the file (only the appended tail when the
+// file just grew). Returns the row count or a status.
+INSPECTION_EXPORT int inspection_load(InspectionStore *store);
+
+INSPECTION_EXPORT int inspection_count(InspectionStore *store);
+
+// Every record whose InspectionID or CarRegNumber equals key (case-insensitive), in file
+// order. Returns the number passed to fn or a status.
+INSPECTION_EXPORT int inspection_lookup(InspectionStore *store, const char *key, InspectionRecordFn fn, void *ctx);
+
+// Every record matching a filter expression, e.g.
+//     plate ^= "ABC" and date >= 01/01/2024 and not owner ~ "fleet"
+// Returns the number passed to fn or a status; on INSPECTION_BAD_QUERY the parser's
+// message is copied to err (if err is not NULL).
+INSPECTION_EXPORT int inspection_query(InspectionStore *store, const char *filter, InspectionRecordFn fn, void *ctx,
+                                       char *err, size_t err_size);
+
+// Every record in file order. Returns the number passed to fn or a status.
+INSPECTION_EXPORT int inspection_iterate(InspectionStore *store, InspectionRecordFn fn, void *ctx);
+
+// Validate r and append it to the file. The date is stored normalized (DD/MM/YYYY).
+INSPECTION_EXPORT int inspection_add(InspectionStore *store, const InspectionRecord *r);
+
+// Replace the record with InspectionID id by r (which may carry a new, unused ID).
+INSPECTION_EXPORT int inspection_update(InspectionStore *store, const char *id, const InspectionRecord *r);
+
+INSPECTION_EXPORT int inspection_delete(InspectionStore *store, const char *id);
+
+INSPECTION_EXPORT void inspection_close(InspectionStore *store);
+
+// static text for a status code
+INSPECTION_EXPORT const char *inspection_strerror(int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INSPECTION_ENGINE_H